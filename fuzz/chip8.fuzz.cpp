@@ -0,0 +1,41 @@
+#include "chip8.h"
+
+#define FUZZ_FRAMES 16
+#define FUZZ_IPF 16
+#define FUZZ_MAX_EVENTS 32
+
+/*
+ * Input layout: one byte n, then n key events of two bytes each
+ * (frame, key | 0x80 for down), then the ROM. The machine is created once
+ * and reset() between inputs, which only restores what the last run dirtied.
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    static Chip8* chip8 = [] {
+        auto* c = new Chip8(EMU_FREQ, P_CHIP8, 0);
+        c->set_IPF(FUZZ_IPF);
+        return c;
+    }();
+
+    if (size < 1)
+        return 0;
+    size_t n_events = std::min<size_t>(data[0], FUZZ_MAX_EVENTS);
+    size_t rom_start = 1 + 2 * n_events;
+    if (rom_start > size || size - rom_start > MAX_ROM_SIZE)
+        return 0;
+    const uint8_t* events = data + 1;
+
+    chip8->reset();
+    chip8->load_rom(data + rom_start, (int) (size - rom_start));
+
+    size_t next = 0;
+    for (int frame = 0; frame < FUZZ_FRAMES; frame++) {
+        for (; next < n_events && events[2 * next] <= frame; next++) {
+            uint8_t ev = events[2 * next + 1];
+            if (ev & 0x80) chip8->press_key(ev & 0xF);
+            else chip8->release_key(ev & 0xF);
+        }
+        if (chip8->run_frame() != 0)
+            break;
+    }
+    return 0;
+}
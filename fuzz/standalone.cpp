@@ -0,0 +1,37 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+// Driver for compilers without libFuzzer: replays the files given on the
+// command line, or with none, feeds random inputs for a quick sanitizer run.
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            std::ifstream file(argv[i], std::ios::binary);
+            std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            LLVMFuzzerTestOneInput(data.data(), data.size());
+        }
+        return 0;
+    }
+
+    std::mt19937_64 gen(1);
+    uint64_t words[64];
+    const int runs = 1000000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++) {
+        size_t len = 1 + gen() % (sizeof(words) - 1);
+        for (size_t j = 0; j < len; j += 8)
+            words[j / 8] = gen();
+        auto* data = (uint8_t*) words;
+        data[0] %= 4;
+        LLVMFuzzerTestOneInput(data, len);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%d runs, %.0f exec/s\n", runs, runs / seconds);
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+// Script lines are "<frame> <key> down|up"; '#' starts a comment.
+int load_input_script(const char* path, std::vector<InputEvent>* events) {
+    std::ifstream file(path);
+    if (!file)
+        return 1;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        int frame;
+        int key;
+        std::string action;
+        if (!(fields >> frame >> std::hex >> key >> action))
+            continue;
+        if (key < 0 || key >= KEYPAD_SIZE || (action != "down" && action != "up"))
+            return 1;
+        events->push_back({frame, (uint8_t) key, action == "down"});
+    }
+    std::stable_sort(events->begin(), events->end(),
+                     [](const InputEvent& a, const InputEvent& b) { return a.frame < b.frame; });
+    return 0;
+}
+
+static uint64_t percentile(const std::vector<uint64_t>& sorted, double p) {
+    if (sorted.empty())
+        return 0;
+    size_t idx = (size_t) (p * (sorted.size() - 1) + 0.5);
+    return sorted[idx];
+}
+
+void json_string(FILE* out, const char* text) {
+    fputc('"', out);
+    for (; *text; text++) {
+        if (*text == '"' || *text == '\\') fputc('\\', out);
+        if ((unsigned char) *text >= 0x20) fputc(*text, out);
+    }
+    fputc('"', out);
+}
+
+// Runs cfg->frames frames headless and writes one JSON object to out.
+// Returns the first non-zero cycle() result, or 0.
+int bench_run(Chip8* chip8, const BenchConfig* cfg, FILE* out) {
+    using clock = std::chrono::steady_clock;
+
+    std::mt19937_64 gen(cfg->seed);
+    std::vector<uint64_t> frame_ns;
+    frame_ns.reserve(cfg->frames);
+    uint64_t mix[16] = {};
+    uint64_t instructions = 0;
+    size_t next_event = 0;
+    int ipf = chip8->IPF_dump();
+    int res = 0;
+
+    auto bench_start = clock::now();
+    for (int frame = 0; frame < cfg->frames && res == 0; frame++) {
+        if (cfg->script.empty()) {
+            // hold or release a random key every few frames
+            if (gen() % 8 == 0) {
+                int key = (int) (gen() % KEYPAD_SIZE);
+                if (chip8->keypad_dump()[key]) chip8->release_key(key);
+                else chip8->press_key(key);
+            }
+        } else {
+            for (; next_event < cfg->script.size() && cfg->script[next_event].frame <= frame; next_event++) {
+                const InputEvent* ev = &cfg->script[next_event];
+                if (ev->down) chip8->press_key(ev->key);
+                else chip8->release_key(ev->key);
+            }
+        }
+
+        auto start = clock::now();
+        for (int i = 0; i < ipf; i++) {
+            res = chip8->cycle();
+            mix[chip8->opcode_dump() >> 12]++;
+            instructions++;
+            if (res != 0)
+                break;
+        }
+        frame_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count());
+    }
+    double seconds = std::chrono::duration<double>(clock::now() - bench_start).count();
+
+    std::vector<uint64_t> sorted = frame_ns;
+    std::sort(sorted.begin(), sorted.end());
+
+    fprintf(out, "{\"rom\":");
+    json_string(out, cfg->rom);
+    fprintf(out, ",\"platform\":\"%s\",\"ipf\":%d,\"seed\":%llu,\"frames\":%zu,",
+            cfg->platform, ipf, (unsigned long long) cfg->seed, frame_ns.size());
+    fprintf(out, "\"instructions\":%llu,\"seconds\":%.6f,\"ips\":%.0f,",
+            (unsigned long long) instructions, seconds, seconds > 0 ? instructions / seconds : 0.0);
+    fprintf(out, "\"frame_ns\":{\"p50\":%llu,\"p99\":%llu,\"max\":%llu},",
+            (unsigned long long) percentile(sorted, 0.50), (unsigned long long) percentile(sorted, 0.99),
+            (unsigned long long) (sorted.empty() ? 0 : sorted.back()));
+    fprintf(out, "\"mix\":{");
+    for (int i = 0; i < 16; i++)
+        fprintf(out, "\"%X\":%llu%s", i, (unsigned long long) mix[i], i < 15 ? "," : "");
+    fprintf(out, "},\"fault\":%d}\n", res);
+    return res;
+}
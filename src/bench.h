@@ -0,0 +1,26 @@
+#ifndef CHIP8EMULATOR_BENCH_H
+#define CHIP8EMULATOR_BENCH_H
+
+#include "chip8.h"
+
+typedef struct {
+    int frame;
+    uint8_t key;
+    bool down;
+} InputEvent;
+
+typedef struct {
+    const char* rom;
+    int frames;
+    const char* platform;
+    uint64_t seed;
+    std::vector<InputEvent> script; // empty for random input
+} BenchConfig;
+
+int load_input_script(const char* path, std::vector<InputEvent>* events);
+
+void json_string(FILE* out, const char* text);
+
+int bench_run(Chip8* chip8, const BenchConfig* cfg, FILE* out);
+
+#endif //CHIP8EMULATOR_BENCH_H
@@ -1,78 +1,265 @@
 #include "chip8.h"
 
+#include <algorithm>
+
 #define DEBUG 0
 #define D_PRINT(PC, OP) (printf("PC: %i, OP: 0x%04x\n", PC, OP))
 
+#define SCREEN_HASH_BASE RAM_SIZE // screen byte i hashes as position RAM_SIZE + i
+
+static inline uint64_t mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// RAM and screen hashes are the XOR of one term per byte, so a write
+// updates them with two terms. Zero bytes add nothing: cleared memory
+// hashes to 0.
+static inline uint64_t hash_term(uint32_t pos, uint8_t value) {
+    return value ? mix64((uint64_t) pos << 8 | value) : 0;
+}
+
+// Screen bytes hash bit by bit instead, so toggling a pixel is the single
+// term screen_term(pos, 1) whatever else the byte holds. Pixels are 0 or 1
+// in practice, which makes this one term too.
+static inline uint64_t screen_term(uint32_t pos, uint8_t value) {
+    uint64_t h = 0;
+    for (; value; value &= value - 1)
+        h ^= hash_term(SCREEN_HASH_BASE + pos, value & -value);
+    return h;
+}
+
+static uint64_t hash_bytes(const uint8_t* data, uint32_t pos, int len) {
+    uint64_t h = 0;
+    for (int i = 0; i < len; i++)
+        h ^= hash_term(pos + i, data[i]);
+    return h;
+}
+
+static uint64_t hash_registers(const uint8_t* V, const uint16_t* stack, uint8_t SP, uint16_t I,
+                               uint16_t PC, uint8_t wait_for_key, uint8_t DT, uint8_t ST) {
+    uint64_t words[7];
+    memcpy(&words[0], V, 16);
+    memcpy(&words[2], stack, 32);
+    words[6] = (uint64_t) PC << 48 | (uint64_t) I << 32 | (uint64_t) SP << 24
+               | (uint64_t) wait_for_key << 16 | DT << 8 | ST;
+    uint64_t h = 0x9E3779B97F4A7C15ULL;
+    for (uint64_t word : words)
+        h = mix64(h ^ word);
+    return h;
+}
+
 
-Chip8::Chip8(int emu_freq, Platform plt, uint64_t seed) : RAM(),
-V(), stack(), screen(), keypad(), screen_updated() {
+Chip8::Chip8(int emu_freq, Platform plt, uint64_t seed) : RAM(), RAM_image(),
+V(), stack(), screen(), keypad(), trace(), screen_updated() {
     this->I = 0;
     this->SP = 0;
     this->PC = PC_OFFSET;
     this->wait_for_key = 0;
-    this->DT = 0;
-    this->ST = 0;
+    this->cycles = 0;
+    this->DT_deadline = 0;
+    this->ST_deadline = 0;
     this->opcode = 0;
+    this->trace_head = 0;
+    this->dirty_pages = 0;
+    this->stale_pages = 0;
+    this->stale_image = 0;
+    this->rom_size = 0;
 
     this->IPF = static_cast<int>(lround(static_cast<double>(emu_freq) / LOOP_FREQ + 0.5));
     this->platform = plt;
+    this->seed = seed;
     this->rng = seed;
 
     for (int i = 0; i < FONT_SIZE; i++)
         this->RAM[FONT_OFFSET + i] = font[i];
+    memcpy(this->RAM_image, this->RAM, RAM_SIZE);
+    this->screen_hash = 0;
+    for (int page = 0; page < RAM_PAGES; page++)
+        this->page_hashes[page] = this->image_hashes[page] = ram_page_hash(this->RAM, page);
 }
 
+// Back to the state right after load_rom. Only RAM pages written since are
+// copied back, so resetting costs about as much as the run dirtied.
 void Chip8::reset() {
-    //memset(this->RAM, 0, RAM_SIZE);
-    memset(this->V, 0, 16);
-    memset(this->stack, 0, 16);
+    for (uint16_t pages = this->dirty_pages; pages; pages &= pages - 1) {
+        int page = __builtin_ctz(pages);
+        memcpy(&this->RAM[page * RAM_PAGE_SIZE], &this->RAM_image[page * RAM_PAGE_SIZE], RAM_PAGE_SIZE);
+        this->page_hashes[page] = this->image_hashes[page];
+        this->stale_pages = (this->stale_pages & ~(1 << page)) | (this->stale_image & (1 << page));
+    }
+    this->dirty_pages = 0;
+
+    memset(this->V, 0, sizeof(this->V));
+    memset(this->stack, 0, sizeof(this->stack));
     memset(this->screen, 0, SCREEN_SIZE);
-    memset(this->keypad, 0, 16);
+    memset(this->keypad, 0, KEYPAD_SIZE);
+    this->screen_hash = 0;
 
     this->I = 0;
     this->SP = 0;
-    this->PC = 0;
+    this->PC = PC_OFFSET;
     this->wait_for_key = 0;
-    this->DT = 0;
-    this->ST = 0;
+    this->cycles = 0;
+    this->DT_deadline = 0;
+    this->ST_deadline = 0;
     this->opcode = 0;
+    this->trace_head = 0;
+    this->rng = this->seed;
+    this->screen_updated = true;
 }
 
-int Chip8::load_rom(unsigned char* rom, int size) {
-    if (size > MAX_ROM_SIZE)
+// Also becomes the image reset() goes back to. Whatever was left past the
+// end of a longer previous ROM is cleared.
+int Chip8::load_rom(const unsigned char* rom, int size) {
+    if (size < 0 || size > MAX_ROM_SIZE)
         return 1;
+
     memcpy(&this->RAM[PC_OFFSET], rom, size);
+    memcpy(&this->RAM_image[PC_OFFSET], rom, size);
+    if (size < this->rom_size) {
+        memset(&this->RAM[PC_OFFSET + size], 0, this->rom_size - size);
+        memset(&this->RAM_image[PC_OFFSET + size], 0, this->rom_size - size);
+    }
+
+    // hashed on first use, so loading stays a copy (the fuzzer reloads
+    // for every input and never asks for a hash)
+    int end = PC_OFFSET + std::max(size, this->rom_size);
+    for (int page = PC_OFFSET / RAM_PAGE_SIZE; page * RAM_PAGE_SIZE < end; page++) {
+        this->stale_pages |= 1 << page;
+        this->stale_image |= 1 << page;
+    }
+    this->rom_size = size;
     return 0;
 }
 
+// Every store the interpreter makes goes through here so reset() knows
+// which pages to restore.
+inline void Chip8::write_ram(uint16_t addr, uint8_t value) {
+    addr &= RAM_SIZE - 1;
+    int page = addr / RAM_PAGE_SIZE;
+    if (!(this->stale_pages & (1 << page)))
+        this->page_hashes[page] ^= hash_term(addr, this->RAM[addr]) ^ hash_term(addr, value);
+    this->RAM[addr] = value;
+    this->dirty_pages |= 1 << page;
+}
+
+// splitmix64, so CXNN is reproducible from the seed and across reset()
+uint8_t Chip8::next_random() {
+    uint64_t z = (this->rng += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (z ^ (z >> 31)) >> 56;
+}
+
 int Chip8::cycle() {
     this->screen_updated = false;
+    uint16_t pc = this->PC;
     this->opcode = fetch_opcode();
-    return decode_and_execute();
+    int res = decode_and_execute();
+    this->cycles++;
+
+    TraceRecord* rec = &this->trace[this->trace_head++ & (TRACE_SIZE - 1)];
+    rec->PC = pc;
+    rec->opcode = this->opcode;
+    rec->reg = (this->opcode & 0x0F00) >> 8;
+    rec->value = this->V[rec->reg];
+    rec->I = this->I;
+    return res;
+}
+
+// Runs one 60Hz frame worth of instructions. A jump to itself can only be
+// left through an interrupt CHIP-8 does not have, so the rest of the frame
+// is skipped rather than spun through.
+int Chip8::run_frame() {
+    for (int i = 0; i < this->IPF; i++) {
+        uint16_t pc = this->PC;
+        int res = cycle();
+        if (res != 0)
+            return res;
+        if ((this->opcode & 0xF000) == 0x1000 && (this->opcode & 0x0FFF) == pc) {
+            skip_cycles(this->IPF - 1 - i);
+            break;
+        }
+    }
+    return 0;
+}
+
+// Deadlines sit on tick boundaries, so a timer set mid-frame first drops
+// at the end of that frame, as if it were decremented once per frame.
+uint64_t Chip8::timer_deadline(uint8_t value) const {
+    return (this->cycles / this->IPF + value) * this->IPF;
+}
+
+uint8_t Chip8::timer_value(uint64_t deadline) const {
+    if (deadline <= this->cycles)
+        return 0;
+    return (deadline - this->cycles + this->IPF - 1) / this->IPF;
 }
 
-void Chip8::decrement_timers() {
-    if (this->DT) this->DT--;
-    if (this->ST) this->ST--;
+uint8_t Chip8::delay_timer() const {
+    return timer_value(this->DT_deadline);
+}
+
+uint8_t Chip8::sound_timer() const {
+    return timer_value(this->ST_deadline);
 }
 
 bool Chip8::sound() const {
-    return this->ST > 0;
+    return this->ST_deadline > this->cycles;
+}
+
+// Cycles until the next running timer reaches zero, or UINT64_MAX if neither
+// is running. Lets idle-skipping code jump straight there.
+uint64_t Chip8::cycles_to_timer_expiry() const {
+    uint64_t next = UINT64_MAX;
+    if (this->DT_deadline > this->cycles)
+        next = this->DT_deadline - this->cycles;
+    if (this->ST_deadline > this->cycles && this->ST_deadline - this->cycles < next)
+        next = this->ST_deadline - this->cycles;
+    return next;
+}
+
+// Advances emulated time without executing anything.
+void Chip8::skip_cycles(uint64_t n) {
+    this->cycles += n;
 }
 
 bool Chip8::screen_is_updated() const {
     return this->screen_updated;
 }
 
+void Chip8::set_IPF(int ipf) {
+    this->IPF = ipf > 0 ? ipf : 1;
+}
+
+int Chip8::rom_size_dump() const {
+    return this->rom_size;
+}
+
+int Chip8::IPF_dump() const {
+    return this->IPF;
+}
+
 // bool ended();
 
 void Chip8::press_key(int key) {
-    if (key < 0 || key >= 15) std::cout << "KEY OUT OF RANGE" << std::endl;
+    if (key < 0 || key >= KEYPAD_SIZE) {
+        std::cout << "KEY OUT OF RANGE" << std::endl;
+        return;
+    }
     this->keypad[key] = 1;
 }
 
 void Chip8::release_key(int key) {
-    if (key < 0 || key >= 15) std::cout << "KEY OUT OF RANGE" << std::endl;
+    if (key < 0 || key >= KEYPAD_SIZE) {
+        std::cout << "KEY OUT OF RANGE" << std::endl;
+        return;
+    }
     this->keypad[key] = 0;
 }
 
@@ -97,38 +284,165 @@ uint8_t* Chip8::reg_dump() {
 uint16_t* Chip8::stack_dump() {
     auto* res = (uint16_t*) calloc(17, sizeof(uint16_t));
     res[0] = this->SP;
-    memcpy(&res[1], this->stack, 16);
+    memcpy(&res[1], this->stack, sizeof(this->stack));
     return res;
 }
 
+const uint16_t* Chip8::stack_view() const {
+    return this->stack;
+}
+
 void Chip8::set_opcode(uint16_t op) {
     this->opcode = op;
 }
 
+// RAM write from outside the interpreter, e.g. a cheat.
+void Chip8::poke(uint16_t addr, uint8_t value) {
+    write_ram(addr, value);
+}
+
 uint16_t Chip8::PC_dump() {
     return this->PC;
 }
 
+uint16_t Chip8::I_dump() {
+    return this->I;
+}
+
+uint8_t Chip8::SP_dump() {
+    return this->SP;
+}
+
+uint16_t Chip8::opcode_dump() {
+    return this->opcode;
+}
+
+uint64_t Chip8::cycles_dump() const {
+    return this->cycles;
+}
+
+const TraceRecord* Chip8::trace_dump() {
+    return this->trace;
+}
+
+uint32_t Chip8::trace_count() {
+    return this->trace_head;
+}
+
+void Chip8::save_state(Chip8State* state) const {
+    memcpy(state->RAM, this->RAM, RAM_SIZE);
+    memcpy(state->screen, this->screen, SCREEN_SIZE);
+    memcpy(state->V, this->V, sizeof(this->V));
+    memcpy(state->stack, this->stack, sizeof(this->stack));
+    state->SP = this->SP;
+    state->I = this->I;
+    state->PC = this->PC;
+    state->wait_for_key = this->wait_for_key;
+    state->DT = delay_timer();
+    state->ST = sound_timer();
+}
+
+// Only bytes that differ are copied and rehashed, so stepping between
+// nearby states (rewind, the explorer) stays cheap.
+void Chip8::load_state(const Chip8State* state) {
+    for (int page = 0; page < RAM_PAGES; page++) {
+        int base = page * RAM_PAGE_SIZE;
+        if (!memcmp(&this->RAM[base], &state->RAM[base], RAM_PAGE_SIZE))
+            continue;
+        for (int addr = base; addr < base + RAM_PAGE_SIZE; addr++)
+            if (this->RAM[addr] != state->RAM[addr])
+                write_ram(addr, state->RAM[addr]);
+    }
+    for (int i = 0; i < SCREEN_SIZE; i++) {
+        if (this->screen[i] != state->screen[i]) {
+            this->screen_hash ^= screen_term(i, this->screen[i] ^ state->screen[i]);
+            this->screen[i] = state->screen[i];
+        }
+    }
+    memcpy(this->V, state->V, sizeof(this->V));
+    memcpy(this->stack, state->stack, sizeof(this->stack));
+    this->SP = state->SP;
+    this->I = state->I;
+    this->PC = state->PC;
+    this->wait_for_key = state->wait_for_key;
+    this->DT_deadline = timer_deadline(state->DT);
+    this->ST_deadline = timer_deadline(state->ST);
+    this->screen_updated = true;
+}
+
+// Hashes the pages load_rom() left stale. A page nothing wrote to since
+// is still the image, so its hash serves for both.
+void Chip8::refresh_hashes() const {
+    for (uint16_t pages = this->stale_pages; pages; pages &= pages - 1) {
+        int page = __builtin_ctz(pages);
+        this->page_hashes[page] = ram_page_hash(this->RAM, page);
+        if (!(this->dirty_pages & (1 << page)) && this->stale_image & (1 << page)) {
+            this->image_hashes[page] = this->page_hashes[page];
+            this->stale_image &= ~(1 << page);
+        }
+    }
+    this->stale_pages = 0;
+}
+
+uint64_t Chip8::state_hash() const {
+    refresh_hashes();
+    uint64_t h = this->screen_hash;
+    for (uint64_t page : this->page_hashes)
+        h ^= page;
+    return mix64(h ^ hash_registers(this->V, this->stack, this->SP, this->I, this->PC,
+                                    this->wait_for_key, delay_timer(), sound_timer()));
+}
+
+uint64_t Chip8::page_hash(int page) const {
+    refresh_hashes();
+    return this->page_hashes[page];
+}
+
+// Bit per RAM page whose contents differ between the two machines (up to
+// hash collisions).
+uint16_t Chip8::diff_pages(const Chip8* other) const {
+    refresh_hashes();
+    other->refresh_hashes();
+    uint16_t diff = 0;
+    for (int page = 0; page < RAM_PAGES; page++)
+        diff |= (this->page_hashes[page] != other->page_hashes[page]) << page;
+    return diff;
+}
+
+uint64_t ram_page_hash(const uint8_t* RAM, int page) {
+    return hash_bytes(&RAM[page * RAM_PAGE_SIZE], page * RAM_PAGE_SIZE, RAM_PAGE_SIZE);
+}
+
+uint64_t chip8_state_hash(const Chip8State* state) {
+    uint64_t h = 0;
+    for (int i = 0; i < SCREEN_SIZE; i++)
+        h ^= screen_term(i, state->screen[i]);
+    for (int page = 0; page < RAM_PAGES; page++)
+        h ^= ram_page_hash(state->RAM, page);
+    return mix64(h ^ hash_registers(state->V, state->stack, state->SP, state->I, state->PC,
+                                    state->wait_for_key, state->DT, state->ST));
+}
+
 void Chip8::op_DXYN(uint8_t X, uint8_t Y, uint8_t N) {
     uint8_t xc = this->V[X] % SCREEN_WIDTH;
     uint8_t yc = this->V[Y] % SCREEN_HEIGHT;
     this->V[0xF] = 0;
 
-    for (uint32_t row = 0; row < N; row++) {
-        uint8_t sprite_pixel = this->RAM[this->I + row];
+    // sprites are clipped at the right and bottom edges, not wrapped
+    for (uint32_t row = 0; row < N && yc + row < SCREEN_HEIGHT; row++) {
+        uint8_t sprite_pixel = this->RAM[(this->I + row) & (RAM_SIZE - 1)];
 
-        for (uint32_t col = 0; col < 8; col++) {
+        for (uint32_t col = 0; col < 8 && xc + col < SCREEN_WIDTH; col++) {
             uint8_t pixel = sprite_pixel & (0x80 >> col);
             if (pixel) {
-                if (this->screen[(yc+row)*SCREEN_WIDTH + (xc+col)])
+                int pos = (yc+row)*SCREEN_WIDTH + (xc+col);
+                uint8_t old = this->screen[pos];
+                if (old)
                     this->V[0xF] = 1;
-                this->screen[(yc+row)*SCREEN_WIDTH + (xc+col)] ^= 1;
+                this->screen[pos] = old ^ 1;
+                this->screen_hash ^= screen_term(pos, 1);
             }
-            if (xc + col == SCREEN_WIDTH)
-                break;
         }
-        if (yc + row == SCREEN_HEIGHT)
-            break;
     }
     this->screen_updated = true;
 }
@@ -177,12 +491,11 @@ int Chip8::decode_and_execute() {
         case 0x0000:
             if (this->opcode == 0x00E0) { // clear screen
                 memset(&this->screen, 0, SCREEN_SIZE);
+                this->screen_hash = 0;
                 this->screen_updated = true;
             } else if (this->opcode == 0x00EE) { // return from subroutine
-                if (this->SP <= 0) {
-                    std::cout << "ERROR IN RETURN FROM SUBROUTINE" << std::endl;
-                    return -1;
-                }
+                if (this->SP <= 0)
+                    return ERR_STACK_UNDERFLOW;
                 this->PC = this->stack[this->SP--];
             }
             break;
@@ -192,10 +505,8 @@ int Chip8::decode_and_execute() {
             break;
 
         case 0x2000: // enter subroutine
-            if (this->SP >= 15) {
-                std::cout << "ERROR IN ENTER SUBROUTINE" << std::endl;
-                return -1;
-            }
+            if (this->SP >= 15)
+                return ERR_STACK_OVERFLOW;
             this->stack[++this->SP] = this->PC;
             this->PC = NNN;
             break;
@@ -276,7 +587,7 @@ int Chip8::decode_and_execute() {
                 }
 
                 default:
-                    return -1;
+                    return ERR_UNKNOWN_OPCODE;
             }
             break;
 
@@ -293,8 +604,7 @@ int Chip8::decode_and_execute() {
             break;
 
         case 0xC000: { // random
-            uint8_t rand = random();
-            this->V[X] = rand & NN;
+            this->V[X] = next_random() & NN;
             break;
         }
 
@@ -305,30 +615,30 @@ int Chip8::decode_and_execute() {
         case 0xE000:
             switch (this->opcode & 0x00FF) {
                 case 0x009E: // skip if key
-                    if (this->keypad[this->V[X]]) this->PC += 2;
+                    if (this->keypad[this->V[X] & 0xF]) this->PC += 2;
                     break;
 
                 case 0x00A1: // skip if not key
-                    if (!this->keypad[this->V[X]]) this->PC += 2;
+                    if (!this->keypad[this->V[X] & 0xF]) this->PC += 2;
                     break;
 
                 default:
-                    return -1;
+                    return ERR_UNKNOWN_OPCODE;
             }
             break;
 
         case 0xF000:
             switch (this->opcode & 0x00FF) {
                 case 0x0007: // VX set to delay timer
-                    this->V[X] = this->DT;
+                    this->V[X] = delay_timer();
                     break;
 
                 case 0x0015: // delay timer set to VX
-                    this->DT = this->V[X];
+                    this->DT_deadline = timer_deadline(this->V[X]);
                     break;
 
                 case 0x0018: // sound timer set to VX
-                    this->ST = this->V[X];
+                    this->ST_deadline = timer_deadline(this->V[X]);
                     break;
 
                 case 0x001E: // add VX to I
@@ -344,40 +654,40 @@ int Chip8::decode_and_execute() {
                     break;
 
                 case 0x0033: // binary coded decimal conversion
-                    this->RAM[this->I] = (this->V[X] / 100) % 10;
-                    this->RAM[this->I + 1] = (this->V[X] / 10) & 10;
-                    this->RAM[this->I + 2] = this->V[X] % 10;
+                    write_ram(this->I, (this->V[X] / 100) % 10);
+                    write_ram(this->I + 1, (this->V[X] / 10) % 10);
+                    write_ram(this->I + 2, this->V[X] % 10);
                     break;
 
                 case 0x0055:
                     for (int i = 0; i <= X; i++)
-                        this->RAM[this->I + i] = this->V[i];
+                        write_ram(this->I + i, this->V[i]);
 
                     this->I += (X + 1); // // only for platform CHIP-8
                     break;
 
                 case 0x0065:
                     for (int i = 0; i <= X; i++)
-                        this->V[i] = this->RAM[this->I + i];
+                        this->V[i] = this->RAM[(this->I + i) & (RAM_SIZE - 1)];
 
                     this->I += (X + 1); // // only for platform CHIP-8
                     break;
 
                 default:
-                    return -1;
+                    return ERR_UNKNOWN_OPCODE;
             }
             break;
 
         default:
-            return -1;
+            return ERR_UNKNOWN_OPCODE;
     }
     DEBUG ? printf("\n") : 0;
     return 0;
 }
 
 uint16_t Chip8::fetch_opcode() {
-    uint8_t first = this->RAM[this->PC++];
-    uint8_t second = this->RAM[this->PC++];
+    uint8_t first = this->RAM[this->PC++ & (RAM_SIZE - 1)];
+    uint8_t second = this->RAM[this->PC++ & (RAM_SIZE - 1)];
     this->opcode = (first << 8) | second;
     return this->opcode;
 }
\ No newline at end of file
@@ -1,15 +1,23 @@
 #ifndef CHIP8EMULATOR_CHIP8_H
 #define CHIP8EMULATOR_CHIP8_H
 
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
 #include <iostream>
 #include <vector>
 #include <fstream>
 #include <random>
-#include <SDL.h>
 
 #define LOOP_FREQ 60
+#define EMU_FREQ 700 // default instructions per second
 
 #define RAM_SIZE 0x1000
+#define RAM_PAGE_SIZE 0x100 // granularity of dirty tracking
+#define RAM_PAGES (RAM_SIZE / RAM_PAGE_SIZE)
 #define FONT_SIZE 0x50
 #define MAX_ROM_SIZE 0xE00 // MEM_SIZE - PC_OFFSET
 
@@ -24,6 +32,13 @@
 
 #define KEYPAD_SIZE 16
 
+#define TRACE_SIZE 256 // must be a power of two
+
+// cycle() results
+#define ERR_UNKNOWN_OPCODE (-1)
+#define ERR_STACK_OVERFLOW (-2)
+#define ERR_STACK_UNDERFLOW (-3)
+
 typedef enum {
     P_CHIP8,      // Enable "modern" CHIP-8 behavior
     P_SCHIP_1_0,  // Enable CHIP-48/S-CHIP 1.0 behavior
@@ -49,9 +64,44 @@ const uint8_t font[] = {
         0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
+// Plain copy of everything a running program can observe. Used to snapshot and
+// restore sessions without exposing the private members of Chip8.
+typedef struct {
+    uint8_t RAM[RAM_SIZE];
+    uint8_t screen[SCREEN_SIZE];
+    uint8_t V[16];
+    uint16_t stack[16];
+    uint8_t SP;
+    uint16_t I;
+    uint16_t PC;
+    uint8_t wait_for_key;
+    uint8_t DT;
+    uint8_t ST;
+} Chip8State;
+
+// One executed instruction, as kept in the always-on trace ring.
+typedef struct {
+    uint16_t PC;
+    uint16_t opcode;
+    uint8_t reg;   // V register the instruction targets (X nibble)
+    uint8_t value; // its value after execution
+    uint16_t I;
+} TraceRecord;
+
 class Chip8 {
     uint8_t RAM[RAM_SIZE];
+    uint8_t RAM_image[RAM_SIZE]; // RAM right after load_rom, restored by reset()
+    uint16_t dirty_pages;        // bit per RAM page written since then
+    int rom_size;
     uint8_t screen[SCREEN_SIZE];
+
+    // Kept up to date on every RAM and screen write; see state_hash().
+    // Pages a ROM was loaded into are hashed when first asked for.
+    mutable uint64_t page_hashes[RAM_PAGES];
+    mutable uint64_t image_hashes[RAM_PAGES]; // of RAM_image
+    mutable uint16_t stale_pages;             // bit per page_hashes entry to recompute
+    mutable uint16_t stale_image;             // same for image_hashes
+    uint64_t screen_hash;
     uint8_t keypad[KEYPAD_SIZE];
 
 
@@ -64,13 +114,20 @@ class Chip8 {
 
     uint8_t wait_for_key;
 
-    uint8_t DT;
-    uint8_t ST;
+    // Timers are kept as the cycle at which they reach zero and only turned
+    // back into 60Hz counts when read. A tick is IPF cycles.
+    uint64_t cycles;
+    uint64_t DT_deadline;
+    uint64_t ST_deadline;
 
     uint16_t opcode;
+    uint64_t seed;
     uint64_t rng;
     int IPF;
 
+    TraceRecord trace[TRACE_SIZE];
+    uint32_t trace_head; // total records written, wraps into trace[]
+
     bool screen_updated;
     Platform platform; // CHIP-8, CHIP-48/S-CHIP 1.0 or S-CHIP 1.1 behavior?
 
@@ -80,16 +137,23 @@ public:
 
     void reset();
 
-    int load_rom(unsigned char* rom, int size);
+    int load_rom(const unsigned char* rom, int size);
 
     int cycle();
+    int run_frame();
     uint16_t fetch_opcode();
     int decode_and_execute();
 
-    void decrement_timers();
+    uint8_t delay_timer() const;
+    uint8_t sound_timer() const;
     bool sound() const;
+    uint64_t cycles_to_timer_expiry() const;
+    void skip_cycles(uint64_t n);
 
     bool screen_is_updated() const;
+    void set_IPF(int ipf);
+    int IPF_dump() const;
+    int rom_size_dump() const;
     // bool ended();
     void press_key(int key);
     void release_key(int key);
@@ -101,14 +165,37 @@ public:
     uint8_t* keypad_dump();
     uint8_t* reg_dump();
     uint16_t* stack_dump();
+    const uint16_t* stack_view() const; // the 16 entries in place, no SP
     uint16_t PC_dump();
+    uint16_t I_dump();
+    uint8_t SP_dump();
+    uint16_t opcode_dump();
+    uint64_t cycles_dump() const;
+    const TraceRecord* trace_dump();
+    uint32_t trace_count();
 
     void set_opcode(uint16_t opcode);
+    void poke(uint16_t addr, uint8_t value);
+
+    void save_state(Chip8State* state) const;
+    void load_state(const Chip8State* state);
+
+    // Hash of everything in Chip8State, in O(1). Equal to
+    // chip8_state_hash() of a saved copy. RAM written through ram_dump()
+    // rather than poke() is not seen.
+    uint64_t state_hash() const;
+    uint64_t page_hash(int page) const;
+    uint16_t diff_pages(const Chip8* other) const;
 
 
     void op_DXYN(uint8_t X, uint8_t Y, uint8_t N);
     void op_FX0A(uint8_t X);
 private:
+    void write_ram(uint16_t addr, uint8_t value);
+    uint8_t next_random();
+    void refresh_hashes() const;
+    uint64_t timer_deadline(uint8_t value) const;
+    uint8_t timer_value(uint64_t deadline) const;
 
 
 
@@ -116,4 +203,8 @@ private:
 
 };
 
+// Full recomputes of the incrementally kept hashes.
+uint64_t ram_page_hash(const uint8_t* RAM, int page);
+uint64_t chip8_state_hash(const Chip8State* state);
+
 #endif //CHIP8EMULATOR_CHIP8_H
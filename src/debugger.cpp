@@ -0,0 +1,321 @@
+#include "debugger.h"
+
+Debugger::Debugger(Chip8* chip8) : chip8(chip8), breakpoints(), n_breakpoints(0), watchpoints(),
+n_watchpoints(0), watch_I(false), conditions(), n_conditions(0), reason(BREAK_NONE), reason_addr(0) {}
+
+void Debugger::add_breakpoint(uint16_t addr) {
+    addr &= RAM_SIZE - 1;
+    if (has_breakpoint(addr))
+        return;
+    this->breakpoints[addr >> 6] |= 1ULL << (addr & 63);
+    this->n_breakpoints++;
+}
+
+void Debugger::remove_breakpoint(uint16_t addr) {
+    addr &= RAM_SIZE - 1;
+    if (!has_breakpoint(addr))
+        return;
+    this->breakpoints[addr >> 6] &= ~(1ULL << (addr & 63));
+    this->n_breakpoints--;
+}
+
+bool Debugger::has_breakpoint(uint16_t addr) const {
+    addr &= RAM_SIZE - 1;
+    return (this->breakpoints[addr >> 6] >> (addr & 63)) & 1;
+}
+
+int Debugger::add_watchpoint(uint16_t start, uint16_t len, uint8_t mode) {
+    if (this->n_watchpoints >= MAX_WATCHPOINTS || len == 0)
+        return 1;
+    this->watchpoints[this->n_watchpoints++] = {start, (uint16_t) (start + len), mode};
+    return 0;
+}
+
+void Debugger::clear_watchpoints() {
+    this->n_watchpoints = 0;
+}
+
+void Debugger::watch_index(bool enable) {
+    this->watch_I = enable;
+}
+
+int Debugger::add_condition(uint8_t reg, CondOp op, uint8_t value) {
+    if (this->n_conditions >= MAX_CONDITIONS || reg > 0xF)
+        return 1;
+    this->conditions[this->n_conditions++] = {reg, op, value};
+    return 0;
+}
+
+void Debugger::clear_conditions() {
+    this->n_conditions = 0;
+}
+
+bool Debugger::armed() const {
+    return this->n_breakpoints || this->n_watchpoints || this->watch_I || this->n_conditions;
+}
+
+BreakReason Debugger::break_reason() const {
+    return this->reason;
+}
+
+uint16_t Debugger::break_addr() const {
+    return this->reason_addr;
+}
+
+// Works out from the opcode alone which RAM the instruction is about to
+// touch, so the interpreter itself needs no hooks.
+bool Debugger::check_watchpoints(uint16_t opcode) {
+    uint16_t I = this->chip8->I_dump();
+    uint8_t X = (opcode & 0x0F00) >> 8;
+    uint16_t start = I & (RAM_SIZE - 1);
+    int len = 0;
+    uint8_t mode = 0;
+    bool writes_I = false;
+
+    switch (opcode & 0xF000) {
+        case 0xA000:
+            writes_I = true;
+            break;
+
+        case 0xD000:
+            len = opcode & 0x000F;
+            mode = WATCH_READ;
+            break;
+
+        case 0xF000:
+            switch (opcode & 0x00FF) {
+                case 0x001E:
+                case 0x0029:
+                    writes_I = true;
+                    break;
+
+                case 0x0033:
+                    len = 3;
+                    mode = WATCH_WRITE;
+                    break;
+
+                case 0x0055:
+                    len = X + 1;
+                    mode = WATCH_WRITE;
+                    writes_I = true;
+                    break;
+
+                case 0x0065:
+                    len = X + 1;
+                    mode = WATCH_READ;
+                    writes_I = true;
+                    break;
+            }
+            break;
+    }
+
+    if (writes_I && this->watch_I) {
+        this->reason = BREAK_INDEX;
+        this->reason_addr = I;
+        return true;
+    }
+
+    // like the interpreter, an access running past the end of RAM wraps
+    // around to 0, so it is split into [start, end) and [0, wrap_end)
+    int end = start + len;
+    int wrap_end = 0;
+    if (end > RAM_SIZE) {
+        wrap_end = end - RAM_SIZE;
+        end = RAM_SIZE;
+    }
+
+    for (int i = 0; i < this->n_watchpoints && mode; i++) {
+        const Watchpoint* w = &this->watchpoints[i];
+        if (!(w->mode & mode))
+            continue;
+        if (start < w->end && w->start < end) {
+            this->reason = BREAK_WATCHPOINT;
+            this->reason_addr = start > w->start ? start : w->start;
+            return true;
+        }
+        if (w->start < wrap_end) {
+            this->reason = BREAK_WATCHPOINT;
+            this->reason_addr = w->start;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Debugger::should_break() {
+    uint16_t PC = this->chip8->PC_dump();
+
+    if (this->n_breakpoints && has_breakpoint(PC)) {
+        this->reason = BREAK_BREAKPOINT;
+        this->reason_addr = PC;
+        return true;
+    }
+
+    if (this->n_watchpoints || this->watch_I) {
+        uint8_t* RAM = this->chip8->ram_dump();
+        uint16_t opcode = (RAM[PC & (RAM_SIZE - 1)] << 8) | RAM[(PC + 1) & (RAM_SIZE - 1)];
+        if (check_watchpoints(opcode))
+            return true;
+    }
+
+    uint8_t* V = this->chip8->reg_dump();
+    for (int i = 0; i < this->n_conditions; i++) {
+        const Condition* c = &this->conditions[i];
+        bool hit = false;
+        switch (c->op) {
+            case COND_EQ: hit = V[c->reg] == c->value; break;
+            case COND_NE: hit = V[c->reg] != c->value; break;
+            case COND_LT: hit = V[c->reg] < c->value; break;
+            case COND_GT: hit = V[c->reg] > c->value; break;
+        }
+        if (hit) {
+            this->reason = BREAK_CONDITION;
+            this->reason_addr = PC;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Executes up to max_cycles instructions, stopping early on a break or a
+// non-zero cycle() result, which is returned.
+int Debugger::run(int max_cycles) {
+    this->reason = BREAK_NONE;
+
+    if (!armed()) {
+        for (int i = 0; i < max_cycles; i++) {
+            int res = this->chip8->cycle();
+            if (res != 0)
+                return res;
+        }
+        return 0;
+    }
+
+    for (int i = 0; i < max_cycles; i++) {
+        if (i > 0 && should_break())
+            return 0;
+        int res = this->chip8->cycle();
+        if (res != 0)
+            return res;
+    }
+    return 0;
+}
+
+int Debugger::step() {
+    int res = run(1);
+    this->reason = BREAK_STEP;
+    this->reason_addr = this->chip8->PC_dump();
+    return res;
+}
+
+// Like step(), but runs a 2NNN call through to its return.
+int Debugger::step_over(int max_cycles) {
+    uint16_t PC = this->chip8->PC_dump();
+    uint8_t* RAM = this->chip8->ram_dump();
+    if ((RAM[PC & (RAM_SIZE - 1)] & 0xF0) != 0x20)
+        return step();
+
+    uint16_t ret = PC + 2;
+    uint8_t SP = this->chip8->SP_dump();
+    this->reason = BREAK_NONE;
+    for (int i = 0; i < max_cycles; i++) {
+        if (i > 0 && armed() && should_break())
+            return 0;
+        int res = this->chip8->cycle();
+        if (res != 0)
+            return res;
+        if (this->chip8->PC_dump() == ret && this->chip8->SP_dump() == SP) {
+            this->reason = BREAK_STEP;
+            this->reason_addr = ret;
+            return 0;
+        }
+    }
+    return 0;
+}
+
+// Runs until the current subroutine executes its 00EE.
+int Debugger::run_to_return(int max_cycles) {
+    uint8_t SP = this->chip8->SP_dump();
+    this->reason = BREAK_NONE;
+    for (int i = 0; i < max_cycles; i++) {
+        if (i > 0 && armed() && should_break())
+            return 0;
+        int res = this->chip8->cycle();
+        if (res != 0)
+            return res;
+        if (this->chip8->SP_dump() < SP) {
+            this->reason = BREAK_STEP;
+            this->reason_addr = this->chip8->PC_dump();
+            return 0;
+        }
+    }
+    return 0;
+}
+
+// Writes a mnemonic for opcode into buff. Returns ERR_UNKNOWN_OPCODE for
+// opcodes the interpreter would reject, like decode_and_execute().
+int disassemble(uint16_t opcode, char* buff, size_t len) {
+    uint8_t X = (opcode & 0x0F00) >> 8;
+    uint8_t Y = (opcode & 0x00F0) >> 4;
+    uint8_t N = opcode & 0x000F;
+    uint8_t NN = opcode & 0x00FF;
+    uint16_t NNN = opcode & 0x0FFF;
+
+    switch (opcode & 0xF000) {
+        case 0x0000:
+            if (opcode == 0x00E0) snprintf(buff, len, "CLS");
+            else if (opcode == 0x00EE) snprintf(buff, len, "RET");
+            else snprintf(buff, len, "SYS 0x%03X", NNN);
+            return 0;
+
+        case 0x1000: snprintf(buff, len, "JP 0x%03X", NNN); return 0;
+        case 0x2000: snprintf(buff, len, "CALL 0x%03X", NNN); return 0;
+        case 0x3000: snprintf(buff, len, "SE V%X, 0x%02X", X, NN); return 0;
+        case 0x4000: snprintf(buff, len, "SNE V%X, 0x%02X", X, NN); return 0;
+        case 0x5000: snprintf(buff, len, "SE V%X, V%X", X, Y); return 0;
+        case 0x6000: snprintf(buff, len, "LD V%X, 0x%02X", X, NN); return 0;
+        case 0x7000: snprintf(buff, len, "ADD V%X, 0x%02X", X, NN); return 0;
+
+        case 0x8000:
+            switch (N) {
+                case 0x0: snprintf(buff, len, "LD V%X, V%X", X, Y); return 0;
+                case 0x1: snprintf(buff, len, "OR V%X, V%X", X, Y); return 0;
+                case 0x2: snprintf(buff, len, "AND V%X, V%X", X, Y); return 0;
+                case 0x3: snprintf(buff, len, "XOR V%X, V%X", X, Y); return 0;
+                case 0x4: snprintf(buff, len, "ADD V%X, V%X", X, Y); return 0;
+                case 0x5: snprintf(buff, len, "SUB V%X, V%X", X, Y); return 0;
+                case 0x6: snprintf(buff, len, "SHR V%X, V%X", X, Y); return 0;
+                case 0x7: snprintf(buff, len, "SUBN V%X, V%X", X, Y); return 0;
+                case 0xE: snprintf(buff, len, "SHL V%X, V%X", X, Y); return 0;
+            }
+            break;
+
+        case 0x9000: snprintf(buff, len, "SNE V%X, V%X", X, Y); return 0;
+        case 0xA000: snprintf(buff, len, "LD I, 0x%03X", NNN); return 0;
+        case 0xB000: snprintf(buff, len, "JP V0, 0x%03X", NNN); return 0;
+        case 0xC000: snprintf(buff, len, "RND V%X, 0x%02X", X, NN); return 0;
+        case 0xD000: snprintf(buff, len, "DRW V%X, V%X, %d", X, Y, N); return 0;
+
+        case 0xE000:
+            if (NN == 0x9E) { snprintf(buff, len, "SKP V%X", X); return 0; }
+            if (NN == 0xA1) { snprintf(buff, len, "SKNP V%X", X); return 0; }
+            break;
+
+        case 0xF000:
+            switch (NN) {
+                case 0x07: snprintf(buff, len, "LD V%X, DT", X); return 0;
+                case 0x0A: snprintf(buff, len, "LD V%X, K", X); return 0;
+                case 0x15: snprintf(buff, len, "LD DT, V%X", X); return 0;
+                case 0x18: snprintf(buff, len, "LD ST, V%X", X); return 0;
+                case 0x1E: snprintf(buff, len, "ADD I, V%X", X); return 0;
+                case 0x29: snprintf(buff, len, "LD F, V%X", X); return 0;
+                case 0x33: snprintf(buff, len, "LD B, V%X", X); return 0;
+                case 0x55: snprintf(buff, len, "LD [I], V%X", X); return 0;
+                case 0x65: snprintf(buff, len, "LD V%X, [I]", X); return 0;
+            }
+            break;
+    }
+
+    snprintf(buff, len, "DW 0x%04X", opcode);
+    return ERR_UNKNOWN_OPCODE;
+}
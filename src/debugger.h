@@ -0,0 +1,94 @@
+#ifndef CHIP8EMULATOR_DEBUGGER_H
+#define CHIP8EMULATOR_DEBUGGER_H
+
+#include "chip8.h"
+
+#define MAX_WATCHPOINTS 16
+#define MAX_CONDITIONS 16
+
+#define WATCH_READ 0x1
+#define WATCH_WRITE 0x2
+
+typedef enum {
+    BREAK_NONE,
+    BREAK_BREAKPOINT,  // PC hit an armed breakpoint
+    BREAK_WATCHPOINT,  // next instruction touches a watched RAM range
+    BREAK_INDEX,       // next instruction writes I
+    BREAK_CONDITION,   // a register condition holds
+    BREAK_STEP,        // step/step_over/run_to_return finished
+} BreakReason;
+
+typedef enum {
+    COND_EQ,
+    COND_NE,
+    COND_LT,
+    COND_GT,
+} CondOp;
+
+typedef struct {
+    uint16_t start;
+    uint16_t end; // exclusive
+    uint8_t mode; // WATCH_READ | WATCH_WRITE
+} Watchpoint;
+
+typedef struct {
+    uint8_t reg;
+    CondOp op;
+    uint8_t value;
+} Condition;
+
+/*
+ * Drives a Chip8 one instruction at a time and stops before any instruction
+ * that trips a breakpoint, watchpoint or condition. Checks happen before the
+ * instruction executes, except for the first instruction of a run so that
+ * resuming from a break always makes progress. With nothing armed, run()
+ * goes straight to Chip8::cycle() and costs nothing extra.
+ */
+class Debugger {
+    Chip8* chip8;
+
+    uint64_t breakpoints[RAM_SIZE / 64];
+    int n_breakpoints;
+
+    Watchpoint watchpoints[MAX_WATCHPOINTS];
+    int n_watchpoints;
+    bool watch_I;
+
+    Condition conditions[MAX_CONDITIONS];
+    int n_conditions;
+
+    BreakReason reason;
+    uint16_t reason_addr;
+
+public:
+    explicit Debugger(Chip8* chip8);
+
+    void add_breakpoint(uint16_t addr);
+    void remove_breakpoint(uint16_t addr);
+    bool has_breakpoint(uint16_t addr) const;
+
+    int add_watchpoint(uint16_t start, uint16_t len, uint8_t mode);
+    void clear_watchpoints();
+    void watch_index(bool enable);
+
+    int add_condition(uint8_t reg, CondOp op, uint8_t value);
+    void clear_conditions();
+
+    bool armed() const;
+
+    int run(int max_cycles);
+    int step();
+    int step_over(int max_cycles);
+    int run_to_return(int max_cycles);
+
+    BreakReason break_reason() const;
+    uint16_t break_addr() const;
+
+private:
+    bool should_break();
+    bool check_watchpoints(uint16_t opcode);
+};
+
+int disassemble(uint16_t opcode, char* buff, size_t len);
+
+#endif //CHIP8EMULATOR_DEBUGGER_H
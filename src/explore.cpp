@@ -0,0 +1,237 @@
+#include "explore.h"
+#include "bench.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+typedef struct {
+    std::mutex lock;
+    std::unordered_map<uint64_t, uint32_t> cells; // state hash -> archive slot
+} Shard;
+
+typedef struct {
+    const ExploreConfig* cfg;
+    const Chip8* start;
+
+    Shard shards[EXPLORE_SHARDS];
+    std::unique_ptr<Chip8State[]> states;
+    std::unique_ptr<std::atomic<uint32_t>[]> visits;
+    std::unique_ptr<std::atomic<bool>[]> ready;
+    std::atomic<uint32_t> n_cells;
+
+    std::atomic<uint64_t> coverage[RAM_SIZE / 64];
+    std::atomic<uint64_t> frames;
+    std::atomic<uint64_t> faults;
+} Archive;
+
+// Marks the PCs of the trace records written since `before`.
+static bool harvest_trace(Chip8* chip8, uint32_t before, uint64_t* cov) {
+    const TraceRecord* trace = chip8->trace_dump();
+    bool new_pc = false;
+    for (uint32_t i = before; i != chip8->trace_count(); i++) {
+        uint16_t pc = trace[i & (TRACE_SIZE - 1)].PC & (RAM_SIZE - 1);
+        uint64_t bit = 1ULL << (pc & 63);
+        if (!(cov[pc >> 6] & bit)) {
+            cov[pc >> 6] |= bit;
+            new_pc = true;
+        }
+    }
+    return new_pc;
+}
+
+// Chip8::run_frame(), except that the trace ring is read every TRACE_SIZE
+// cycles, before it wraps, so no PC is lost when IPF is above TRACE_SIZE.
+static int run_frame_covered(Chip8* chip8, uint64_t* cov, bool* new_pc) {
+    int ipf = chip8->IPF_dump();
+    uint32_t before = chip8->trace_count();
+    int res = 0;
+    for (int i = 0; i < ipf; i++) {
+        uint16_t pc = chip8->PC_dump();
+        res = chip8->cycle();
+        if (res != 0)
+            break;
+        uint16_t opcode = chip8->opcode_dump();
+        if ((opcode & 0xF000) == 0x1000 && (opcode & 0x0FFF) == pc) {
+            chip8->skip_cycles(ipf - 1 - i);
+            break;
+        }
+        if (chip8->trace_count() - before == TRACE_SIZE) {
+            *new_pc |= harvest_trace(chip8, before, cov);
+            before = chip8->trace_count();
+        }
+    }
+    *new_pc |= harvest_trace(chip8, before, cov);
+    return res;
+}
+
+// Returns true if the state was new and made it into the archive.
+static bool archive_add(Archive* archive, uint64_t key, Chip8* chip8) {
+    Shard* shard = &archive->shards[key % EXPLORE_SHARDS];
+    std::lock_guard<std::mutex> guard(shard->lock);
+    if (shard->cells.count(key))
+        return false;
+
+    uint32_t slot = archive->n_cells.fetch_add(1);
+    if (slot >= (uint32_t) archive->cfg->max_cells) {
+        archive->n_cells.store(archive->cfg->max_cells);
+        return false;
+    }
+    chip8->save_state(&archive->states[slot]);
+    archive->ready[slot].store(true, std::memory_order_release);
+    shard->cells[key] = slot;
+    return true;
+}
+
+// Tournament pick: the least visited of a few random cells.
+static uint32_t archive_select(Archive* archive, std::mt19937_64* gen) {
+    uint32_t n = std::min(archive->n_cells.load(), (uint32_t) archive->cfg->max_cells);
+    uint32_t best = 0;
+    uint32_t best_visits = UINT32_MAX;
+    for (int i = 0; i < EXPLORE_CANDIDATES; i++) {
+        uint32_t slot = (*gen)() % n;
+        if (!archive->ready[slot].load(std::memory_order_acquire))
+            continue;
+        uint32_t v = archive->visits[slot].load(std::memory_order_relaxed);
+        if (v < best_visits) {
+            best = slot;
+            best_visits = v;
+        }
+    }
+    archive->visits[best].fetch_add(1, std::memory_order_relaxed);
+    return best;
+}
+
+static void explore_worker(Archive* archive, uint64_t seed) {
+    const ExploreConfig* cfg = archive->cfg;
+    std::mt19937_64 gen(seed);
+    Chip8 chip8 = *archive->start;
+    uint64_t local_cov[RAM_SIZE / 64] = {};
+    uint64_t merged_cov[RAM_SIZE / 64] = {};
+
+    while (archive->frames.load(std::memory_order_relaxed) < cfg->frames) {
+        uint32_t slot = archive_select(archive, &gen);
+        chip8.load_state(&archive->states[slot]);
+        for (int k = 0; k < KEYPAD_SIZE; k++)
+            chip8.release_key(k);
+
+        int frames = 0;
+        bool found = false;
+        for (; frames < cfg->step_frames; frames++) {
+            // sticky input: keys stay as they are most frames
+            uint64_t r = gen();
+            if (r % 8 == 0) {
+                int key = (int) ((r >> 8) % KEYPAD_SIZE);
+                if (chip8.keypad_dump()[key]) chip8.release_key(key);
+                else chip8.press_key(key);
+            } else if (r % 64 == 1) {
+                for (int k = 0; k < KEYPAD_SIZE; k++)
+                    chip8.release_key(k);
+            }
+
+            bool new_pc = false;
+            int res = run_frame_covered(&chip8, local_cov, &new_pc);
+
+            if (res != 0) {
+                archive->faults.fetch_add(1, std::memory_order_relaxed);
+                frames++;
+                break;
+            }
+
+            if (new_pc) {
+                // only globally new PCs make a state interesting on their own
+                for (int w = 0; w < RAM_SIZE / 64; w++) {
+                    uint64_t fresh = local_cov[w] & ~merged_cov[w];
+                    if (!fresh)
+                        continue;
+                    uint64_t prev = archive->coverage[w].fetch_or(fresh, std::memory_order_relaxed);
+                    merged_cov[w] |= fresh;
+                    if (fresh & ~prev)
+                        found = true;
+                }
+            }
+            if (archive_add(archive, chip8.state_hash(), &chip8))
+                found = true;
+        }
+        archive->frames.fetch_add(frames, std::memory_order_relaxed);
+
+        // a productive cell earns another look sooner
+        if (found && archive->visits[slot].load(std::memory_order_relaxed) > 0)
+            archive->visits[slot].fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+int explore_run(const Chip8* start, const ExploreConfig* cfg, ExploreReport* report) {
+    using clock = std::chrono::steady_clock;
+
+    ExploreConfig config = *cfg;
+    if (config.threads <= 0)
+        config.threads = std::max(1u, std::thread::hardware_concurrency());
+    if (config.step_frames <= 0)
+        config.step_frames = EXPLORE_STEP_FRAMES;
+    if (config.max_cells <= 0)
+        config.max_cells = EXPLORE_MAX_CELLS;
+
+    auto archive = std::make_unique<Archive>();
+    archive->cfg = &config;
+    archive->start = start;
+    archive->states.reset(new Chip8State[config.max_cells]);
+    archive->visits.reset(new std::atomic<uint32_t>[config.max_cells]());
+    archive->ready.reset(new std::atomic<bool>[config.max_cells]());
+    archive->n_cells = 0;
+    for (auto& w : archive->coverage)
+        w = 0;
+    archive->frames = 0;
+    archive->faults = 0;
+
+    Chip8 root = *start;
+    archive_add(archive.get(), root.state_hash(), &root);
+
+    auto begin = clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < config.threads; i++)
+        threads.emplace_back(explore_worker, archive.get(), config.seed + i * 0x9E3779B97F4A7C15ULL);
+    for (auto& t : threads)
+        t.join();
+
+    report->frames = archive->frames;
+    report->cells = std::min(archive->n_cells.load(), (uint32_t) config.max_cells);
+    report->faults = archive->faults;
+    report->seconds = std::chrono::duration<double>(clock::now() - begin).count();
+    for (int w = 0; w < RAM_SIZE / 64; w++)
+        report->coverage[w] = archive->coverage[w];
+    return 0;
+}
+
+// One JSON object: totals plus the covered PCs as [first, last] ranges.
+void explore_print_report(const ExploreReport* report, const char* rom, FILE* out) {
+    auto covered = [report](int pc) { return (report->coverage[pc >> 6] >> (pc & 63)) & 1; };
+    int n_covered = 0;
+    for (uint64_t w : report->coverage)
+        n_covered += __builtin_popcountll(w);
+
+    fprintf(out, "{\"rom\":");
+    json_string(out, rom);
+    fprintf(out, ",\"frames\":%llu,\"seconds\":%.6f,\"fps\":%.0f,\"cells\":%llu,\"faults\":%llu,",
+            (unsigned long long) report->frames, report->seconds,
+            report->seconds > 0 ? report->frames / report->seconds : 0.0,
+            (unsigned long long) report->cells, (unsigned long long) report->faults);
+    fprintf(out, "\"pcs_covered\":%d,\"ranges\":[", n_covered);
+
+    bool first = true;
+    for (int pc = 0; pc < RAM_SIZE; pc++) {
+        if (!covered(pc))
+            continue;
+        // instructions are two bytes wide, so a one byte hole does not split a range
+        int end = pc;
+        while (end + 1 < RAM_SIZE && (covered(end + 1) || (end + 2 < RAM_SIZE && covered(end + 2))))
+            end++;
+        fprintf(out, "%s[%d,%d]", first ? "" : ",", pc, end);
+        first = false;
+        pc = end;
+    }
+    fprintf(out, "]}\n");
+}
@@ -0,0 +1,38 @@
+#ifndef CHIP8EMULATOR_EXPLORE_H
+#define CHIP8EMULATOR_EXPLORE_H
+
+#include "chip8.h"
+
+#define EXPLORE_SHARDS 64
+#define EXPLORE_MAX_CELLS 20000
+#define EXPLORE_STEP_FRAMES 60
+#define EXPLORE_CANDIDATES 4
+
+typedef struct {
+    int threads;          // 0 uses every core
+    uint64_t frames;      // total emulated frame budget across all threads
+    int step_frames;      // frames explored from a cell before returning
+    int max_cells;
+    uint64_t seed;
+} ExploreConfig;
+
+typedef struct {
+    uint64_t frames;
+    uint64_t cells;
+    uint64_t faults;
+    double seconds;
+    uint64_t coverage[RAM_SIZE / 64]; // bit per PC that executed
+} ExploreReport;
+
+/*
+ * Go-Explore style state exploration. Every thread repeatedly picks a cell
+ * from a shared archive of distinct states, favouring rarely picked ones,
+ * restores it and plays random sticky keypad input for a while. States whose
+ * (screen, RAM, registers) hash is new, or that executed a PC nobody had
+ * reached yet, are added to the archive.
+ */
+int explore_run(const Chip8* start, const ExploreConfig* cfg, ExploreReport* report);
+
+void explore_print_report(const ExploreReport* report, const char* rom, FILE* out);
+
+#endif //CHIP8EMULATOR_EXPLORE_H
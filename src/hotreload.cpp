@@ -0,0 +1,81 @@
+#include "hotreload.h"
+
+#include <algorithm>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+int romwatch_create(RomWatch* watch, const char* path) {
+    watch->fd = -1;
+    watch->wd = -1;
+
+    std::string full = path;
+    size_t slash = full.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : full.substr(0, slash + 1);
+    std::string name = slash == std::string::npos ? full : full.substr(slash + 1);
+    if (name.empty() || name.size() > NAME_MAX)
+        return 1;
+    strcpy(watch->name, name.c_str());
+
+    watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch->fd < 0)
+        return 1;
+    watch->wd = inotify_add_watch(watch->fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watch->wd < 0) {
+        romwatch_destroy(watch);
+        return 1;
+    }
+    return 0;
+}
+
+// Drains pending events without blocking. Returns 1 if the ROM was written
+// or replaced since the last call.
+int romwatch_poll(RomWatch* watch) {
+    alignas(struct inotify_event) char buff[4096];
+    int changed = 0;
+
+    while (true) {
+        ssize_t n = read(watch->fd, buff, sizeof(buff));
+        if (n <= 0)
+            break;
+        for (char* p = buff; p < buff + n;) {
+            auto* ev = (struct inotify_event*) p;
+            if (ev->len && !strcmp(ev->name, watch->name))
+                changed = 1;
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+    return changed;
+}
+
+void romwatch_destroy(RomWatch* watch) {
+    if (watch->fd >= 0)
+        close(watch->fd);
+    watch->fd = -1;
+    watch->wd = -1;
+}
+
+// Swaps a new ROM into a running machine. With a resume state, its
+// registers, screen and RAM are kept and only the program bytes are
+// replaced, so an edit can be tried without replaying up to that point.
+// Like load_rom(), whatever a longer old ROM left past the new one is
+// cleared: both the ROM running now and resume_rom_size, the one that was
+// loaded when resume was saved.
+int hotreload_apply(Chip8* chip8, const uint8_t* rom, int size, const Chip8State* resume, int resume_rom_size) {
+    if (size < 0 || size > MAX_ROM_SIZE)
+        return 1;
+
+    Chip8State state;
+    if (resume)
+        state = *resume;
+    int old_size = std::max(chip8->rom_size_dump(), resume_rom_size);
+
+    chip8->reset();
+    chip8->load_rom(rom, size);
+    if (resume) {
+        memcpy(&state.RAM[PC_OFFSET], rom, size);
+        if (size < old_size)
+            memset(&state.RAM[PC_OFFSET + size], 0, old_size - size);
+        chip8->load_state(&state);
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+#ifndef CHIP8EMULATOR_HOTRELOAD_H
+#define CHIP8EMULATOR_HOTRELOAD_H
+
+#include "chip8.h"
+
+#include <climits>
+
+typedef enum {
+    RELOAD_FRESH,      // start the new ROM from scratch
+    RELOAD_KEEP,       // new code, current registers and data
+    RELOAD_CHECKPOINT, // new code, registers and data from the saved checkpoint
+} ReloadMode;
+
+/*
+ * Watches a ROM file with inotify. The directory is watched rather than the
+ * file so that editors which save by writing a temporary and renaming it
+ * over the original are noticed too.
+ */
+typedef struct {
+    int fd;
+    int wd;
+    char name[NAME_MAX + 1];
+} RomWatch;
+
+int romwatch_create(RomWatch* watch, const char* path);
+
+int romwatch_poll(RomWatch* watch);
+
+void romwatch_destroy(RomWatch* watch);
+
+int hotreload_apply(Chip8* chip8, const uint8_t* rom, int size, const Chip8State* resume, int resume_rom_size);
+
+#endif //CHIP8EMULATOR_HOTRELOAD_H
@@ -1,56 +1,187 @@
 #include "window.h"
+#include "bench.h"
+#include "explore.h"
+#include "options.h"
+#include "trace.h"
+
+// Picks up a rewritten ROM. Keys still held down are pressed again, since
+// reset() releases them.
+static void reload_rom(Chip8* chip8, const Options* opts, const Chip8State* checkpoint, int checkpoint_rom_size,
+                       Rewind* rewind) {
+    uint8_t buff[MAX_ROM_SIZE];
+    int size;
+    Chip8State current;
+    const Chip8State* resume = nullptr;
+    int resume_rom_size = 0;
+
+    if (opts->reload == RELOAD_KEEP) {
+        chip8->save_state(&current);
+        resume = &current;
+        resume_rom_size = chip8->rom_size_dump();
+    } else if (opts->reload == RELOAD_CHECKPOINT) {
+        resume = checkpoint;
+        resume_rom_size = checkpoint_rom_size;
+    }
+
+    if (read_rom(opts->rom, buff, &size) || hotreload_apply(chip8, buff, size, resume, resume_rom_size)) {
+        SDL_Log("Reload of %s failed\n", opts->rom);
+        return;
+    }
+    rewind_clear(rewind);
+
+    const uint8_t* held = SDL_GetKeyboardState(nullptr);
+    for (int i = 0; i < KEYPAD_SIZE; i++)
+        if (held[(int) keys[i]]) chip8->press_key(i);
+    SDL_Log("Reloaded %s\n", opts->rom);
+}
 
 int main(int argc, char* argv[]) {
     GfxContext ctx;
+    Options opts;
 
-    gfx_create(&ctx);
-    Chip8* chip8 = (Chip8*) new Chip8(LOOP_FREQ, P_CHIP8, time(nullptr));
-
-    SDL_RWops *file = nullptr;
-    if (!(file = SDL_RWFromFile(argv[1], "rb"))) {
-        SDL_Log("Error: ROM file not found\n");
+    if (parse_options(argc, argv, &opts)) {
+        print_usage(argv[0]);
         return 1;
     }
+
     uint8_t buff[MAX_ROM_SIZE];
-    SDL_RWread(file, buff, 1, MAX_ROM_SIZE);
-    SDL_RWclose(file);
+    int size;
+    if (read_rom(opts.rom, buff, &size)) {
+        fprintf(stderr, "Error: ROM file not found\n");
+        return 1;
+    }
+
+    Chip8* chip8 = (Chip8*) new Chip8(EMU_FREQ, opts.platform, opts.seed);
+    if (opts.ipf)
+        chip8->set_IPF(opts.ipf);
 
     // load program into chip8 memory
-    chip8->load_rom(buff, MAX_ROM_SIZE);
+    chip8->load_rom(buff, size);
+
+    // headless benchmark, no SDL involved
+    if (opts.bench_frames) {
+        BenchConfig cfg = {opts.rom, opts.bench_frames, platform_name(opts.platform), opts.seed, {}};
+        if (opts.input && load_input_script(opts.input, &cfg.script)) {
+            fprintf(stderr, "Error: could not read input script %s\n", opts.input);
+            delete chip8;
+            return 1;
+        }
+        int res = bench_run(chip8, &cfg, stdout);
+        if (res != 0)
+            trace_write(TRACE_FILE, chip8, res);
+        delete chip8;
+        return res != 0;
+    }
+
+    // headless coverage-guided exploration
+    if (opts.explore_frames) {
+        ExploreConfig cfg = {opts.threads, opts.explore_frames, EXPLORE_STEP_FRAMES, EXPLORE_MAX_CELLS, opts.seed};
+        ExploreReport report;
+        explore_run(chip8, &cfg, &report);
+        explore_print_report(&report, opts.rom, stdout);
+        delete chip8;
+        return 0;
+    }
+
+    if (gfx_create(&ctx, opts.filter, opts.decay)) {
+        fprintf(stderr, "Error: out of memory\n");
+        delete chip8;
+        return 1;
+    }
+    // input and timing are polled before the first frame opens the window
+    if (SDL_Init(SDL_INIT_EVENTS)) {
+        SDL_Log("Error: %s\n", SDL_GetError());
+        gfx_destroy(&ctx);
+        delete chip8;
+        return 1;
+    }
+
+    Rewind rewind = {};
+    bool can_rewind = opts.rewind_mb > 0 && rewind_create(&rewind, (size_t) opts.rewind_mb << 20) == 0;
+    const uint8_t* held = SDL_GetKeyboardState(nullptr);
+
+    RomWatch watch = {-1, -1, {}};
+    if (opts.watch && romwatch_create(&watch, opts.rom))
+        SDL_Log("Cannot watch %s, hot reload disabled\n", opts.rom);
+    ShmExport shm = {};
+    if (opts.export_name && shmexport_create(&shm, opts.export_name))
+        SDL_Log("Cannot create %s, frame export disabled\n", opts.export_name);
+    uint64_t frame = 0;
+
+    Chip8State checkpoint;
+    int checkpoint_rom_size = 0; // ROM loaded when it was saved
+    bool has_checkpoint = false;
+    bool f5_down = false;
+    bool f9_down = false;
 
     uint64_t start = 0;
     uint64_t end = 0;
+    int status = 0;
 
     while (true) {
         start = SDL_GetTicks64();
         // Handle input
         if (handle_input(chip8)) break;
 
-        // fetch, decode, execute
-        if (chip8->cycle() != 0) {
-            SDL_Log("Unknown opcode 0x%x\n", chip8->fetch_opcode());
-            gfx_destroy(&ctx);
-            return 1;
+        if (held[SDL_SCANCODE_F5] && !f5_down) {
+            chip8->save_state(&checkpoint);
+            checkpoint_rom_size = chip8->rom_size_dump();
+            has_checkpoint = true;
+            SDL_Log("Checkpoint saved\n");
+        }
+        if (held[SDL_SCANCODE_F9] && !f9_down && has_checkpoint) {
+            chip8->load_state(&checkpoint);
+            rewind_clear(&rewind);
+        }
+        f5_down = held[SDL_SCANCODE_F5];
+        f9_down = held[SDL_SCANCODE_F9];
+
+        // checked every frame, so a save shows up within about 16ms
+        if (watch.fd >= 0 && romwatch_poll(&watch))
+            reload_rom(chip8, &opts, has_checkpoint ? &checkpoint : nullptr, checkpoint_rom_size, &rewind);
+
+        if (can_rewind && held[SDL_SCANCODE_BACKSPACE]) {
+            // one frame back per frame held, so rewinding plays at normal speed
+            rewind_step_back(&rewind, chip8);
+        } else {
+            // one 60Hz frame of fetch, decode, execute; timers follow on their own
+            int res = chip8->run_frame();
+            if (res != 0) {
+                SDL_Log("Fault: %s at opcode 0x%x\n", fault_name(res), chip8->opcode_dump());
+                if (trace_write(TRACE_FILE, chip8, res) == 0)
+                    SDL_Log("Trace written to %s\n", TRACE_FILE);
+                status = 1;
+                break;
+            }
+            cheats_apply(&opts.cheats, chip8);
+            if (can_rewind)
+                rewind_push(&rewind, chip8);
         }
 
-        // decrement timers
-        chip8->decrement_timers();
+        if (shm.ring)
+            shmexport_publish(&shm, chip8, frame);
+        frame++;
 
-        // update screen iff screen has been updated
-        if (chip8->screen_is_updated()) {
-            uint8_t* res = chip8->screen_dump();
-            gfx_update(&ctx, res);
+        // present every frame; the phosphor blend hides XOR flicker
+        if (gfx_update(&ctx, chip8->screen_dump())) {
+            SDL_Log("Error: %s\n", SDL_GetError());
+            status = 1;
+            break;
         }
 
         // get time taken to execute everything
         end = SDL_GetTicks64();
         uint32_t total_time = end - start;
-        if (total_time < 2)
-            SDL_Delay(2-total_time);
+        if (total_time < 1000 / LOOP_FREQ)
+            SDL_Delay(1000 / LOOP_FREQ - total_time);
 
         SDL_PumpEvents();
     }
 
+    shmexport_destroy(&shm);
+    romwatch_destroy(&watch);
+    rewind_destroy(&rewind);
     gfx_destroy(&ctx);
-    return 0;
+    delete chip8;
+    return status;
 }
@@ -0,0 +1,130 @@
+#include "options.h"
+
+#include <charconv>
+#include <ctime>
+
+static int parse_uint(const char* text, uint64_t* value) {
+    const char* end = text + strlen(text);
+    auto res = std::from_chars(text, end, *value);
+    return res.ec != std::errc() || res.ptr != end;
+}
+
+// ADDR=VAL, both in hex
+static int parse_cheat(const char* text, CheatList* cheats, bool freeze) {
+    unsigned addr, value;
+    int consumed = 0;
+    if (sscanf(text, "%x=%x%n", &addr, &value, &consumed) != 2 || text[consumed] != '\0')
+        return 1;
+    if (addr >= RAM_SIZE || value > 0xFF)
+        return 1;
+    return cheats_add(cheats, addr, value, freeze);
+}
+
+int parse_options(int argc, char* argv[], Options* opts) {
+    *opts = {};
+    opts->platform = P_CHIP8;
+    opts->seed = time(nullptr);
+    opts->filter = FILTER_SCALE2X;
+    opts->decay = PHOSPHOR_DECAY;
+    opts->rewind_mb = REWIND_DEFAULT_MB;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        uint64_t value;
+
+        if (arg[0] != '-') {
+            if (opts->rom)
+                return 1;
+            opts->rom = argv[i];
+            continue;
+        }
+        if (i + 1 >= argc)
+            return 1;
+        const char* next = argv[++i];
+
+        if (arg == "--ipf") {
+            if (parse_uint(next, &value) || value == 0 || value > 1000000) return 1;
+            opts->ipf = (int) value;
+        } else if (arg == "--platform") {
+            if (!strcmp(next, "chip8")) opts->platform = P_CHIP8;
+            else if (!strcmp(next, "schip1.0")) opts->platform = P_SCHIP_1_0;
+            else if (!strcmp(next, "schip1.1")) opts->platform = P_SCHIP_1_1;
+            else return 1;
+        } else if (arg == "--seed") {
+            if (parse_uint(next, &opts->seed)) return 1;
+        } else if (arg == "--filter") {
+            if (!strcmp(next, "nearest")) opts->filter = FILTER_NEAREST;
+            else if (!strcmp(next, "scale2x")) opts->filter = FILTER_SCALE2X;
+            else if (!strcmp(next, "scale3x")) opts->filter = FILTER_SCALE3X;
+            else return 1;
+        } else if (arg == "--decay") {
+            if (parse_uint(next, &value) || value > 0xFF) return 1;
+            opts->decay = value;
+        } else if (arg == "--bench") {
+            if (parse_uint(next, &value) || value == 0 || value > INT32_MAX) return 1;
+            opts->bench_frames = (int) value;
+        } else if (arg == "--explore") {
+            if (parse_uint(next, &opts->explore_frames) || opts->explore_frames == 0) return 1;
+        } else if (arg == "--threads") {
+            if (parse_uint(next, &value) || value > 4096) return 1;
+            opts->threads = (int) value;
+        } else if (arg == "--poke" || arg == "--freeze") {
+            if (parse_cheat(next, &opts->cheats, arg == "--freeze")) return 1;
+        } else if (arg == "--rewind-mb") {
+            if (parse_uint(next, &value) || value > 4096) return 1;
+            opts->rewind_mb = (int) value;
+        } else if (arg == "--watch") {
+            if (!strcmp(next, "fresh")) opts->reload = RELOAD_FRESH;
+            else if (!strcmp(next, "keep")) opts->reload = RELOAD_KEEP;
+            else if (!strcmp(next, "checkpoint")) opts->reload = RELOAD_CHECKPOINT;
+            else return 1;
+            opts->watch = true;
+        } else if (arg == "--export") {
+            if (next[0] != '/') return 1;
+            opts->export_name = next;
+        } else if (arg == "--input") {
+            opts->input = strcmp(next, "random") ? next : nullptr;
+        } else {
+            return 1;
+        }
+    }
+    return opts->rom == nullptr;
+}
+
+void print_usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [options] <rom>\n"
+            "  --ipf N                  instructions per 60Hz frame (default: %d)\n"
+            "  --platform P             chip8, schip1.0 or schip1.1\n"
+            "  --seed N                 random seed (default: current time)\n"
+            "  --filter F               nearest, scale2x or scale3x\n"
+            "  --decay N                phosphor intensity kept per frame, 0-255\n"
+            "  --bench FRAMES           run headless and print a JSON report\n"
+            "  --input random|SCRIPT    bench input; script lines are '<frame> <key> down|up'\n"
+            "  --explore FRAMES         explore reachable states, print PC coverage as JSON\n"
+            "  --threads N              explorer threads (default: one per core)\n"
+            "  --poke ADDR=VAL          write a RAM byte once after the first frame (hex)\n"
+            "  --freeze ADDR=VAL        rewrite a RAM byte after every frame (hex)\n"
+            "  --rewind-mb N            rewind history budget, hold Backspace to rewind (default: %d)\n"
+            "  --watch MODE             reload the ROM when it is saved; MODE is fresh, keep\n"
+            "                           (current state) or checkpoint (F5 saves, F9 restores)\n"
+            "  --export NAME            publish every frame to shared memory NAME (e.g. /chip8)\n",
+            prog, Chip8(EMU_FREQ, P_CHIP8, 0).IPF_dump(), REWIND_DEFAULT_MB);
+}
+
+const char* platform_name(Platform plt) {
+    switch (plt) {
+        case P_SCHIP_1_0: return "schip1.0";
+        case P_SCHIP_1_1: return "schip1.1";
+        default: return "chip8";
+    }
+}
+
+int read_rom(const char* path, uint8_t* buff, int* size) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return 1;
+    file.read((char*) buff, MAX_ROM_SIZE);
+    *size = (int) file.gcount();
+    return 0;
+}
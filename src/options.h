@@ -0,0 +1,42 @@
+#ifndef CHIP8EMULATOR_OPTIONS_H
+#define CHIP8EMULATOR_OPTIONS_H
+
+#include "chip8.h"
+#include "hotreload.h"
+#include "ramsearch.h"
+#include "rewind.h"
+#include "shmexport.h"
+#include "upscale.h"
+
+typedef struct {
+    const char* rom;
+    int ipf;              // 0 keeps the value derived from EMU_FREQ
+    Platform platform;
+    uint64_t seed;
+    UpscaleFilter filter;
+    uint8_t decay;
+
+    int bench_frames;     // > 0 runs headless for this many frames
+    const char* input;    // bench input script, nullptr for random input
+
+    uint64_t explore_frames; // > 0 runs the state explorer for this many frames
+    int threads;             // explorer threads, 0 for one per core
+
+    CheatList cheats;        // --poke and --freeze writes
+    int rewind_mb;           // rewind history budget, 0 disables it
+
+    bool watch;              // reload the ROM when it changes on disk
+    ReloadMode reload;
+
+    const char* export_name; // shared-memory ring to publish frames to
+} Options;
+
+int parse_options(int argc, char* argv[], Options* opts);
+
+void print_usage(const char* prog);
+
+const char* platform_name(Platform plt);
+
+int read_rom(const char* path, uint8_t* buff, int* size);
+
+#endif //CHIP8EMULATOR_OPTIONS_H
@@ -0,0 +1,198 @@
+#include "ramsearch.h"
+
+void ramsearch_reset(RamSearch* search) {
+    memset(search->candidates, 0xFF, RAM_SIZE);
+    memset(search->previous, 0, RAM_SIZE);
+    search->has_previous = false;
+    search->count = RAM_SIZE;
+    search->simd = detect_simd();
+}
+
+static bool test_scalar(uint8_t cur, uint8_t prev, SearchPredicate pred, uint8_t value) {
+    switch (pred) {
+        case SEARCH_EQUAL: return cur == prev;
+        case SEARCH_CHANGED: return cur != prev;
+        case SEARCH_INCREASED: return cur > prev;
+        case SEARCH_DECREASED: return cur < prev;
+        case SEARCH_VALUE: return cur == value;
+    }
+    return false;
+}
+
+/*
+ * Mask kernels: candidates &= pred(cur, prev) over the whole RAM, returning
+ * how many candidates survive.
+ */
+
+static int filter_mask_scalar(uint8_t* candidates, const uint8_t* cur, const uint8_t* prev,
+                              SearchPredicate pred, uint8_t value) {
+    int count = 0;
+    for (int i = 0; i < RAM_SIZE; i++) {
+        if (candidates[i] && !test_scalar(cur[i], prev[i], pred, value))
+            candidates[i] = 0;
+        count += candidates[i] != 0;
+    }
+    return count;
+}
+
+#ifdef CHIP8_X86
+static int filter_mask_sse2(uint8_t* candidates, const uint8_t* cur, const uint8_t* prev,
+                            SearchPredicate pred, uint8_t value) {
+    const __m128i ones = _mm_set1_epi8(-1);
+    const __m128i bias = _mm_set1_epi8((char) 0x80); // unsigned compare via signed
+    const __m128i val = _mm_set1_epi8((char) value);
+    int count = 0;
+
+    for (int i = 0; i < RAM_SIZE; i += 16) {
+        __m128i cand = _mm_load_si128((const __m128i*) &candidates[i]);
+        __m128i a = _mm_loadu_si128((const __m128i*) &cur[i]);
+        __m128i b = _mm_loadu_si128((const __m128i*) &prev[i]);
+        __m128i m;
+        switch (pred) {
+            case SEARCH_EQUAL: m = _mm_cmpeq_epi8(a, b); break;
+            case SEARCH_CHANGED: m = _mm_xor_si128(_mm_cmpeq_epi8(a, b), ones); break;
+            case SEARCH_INCREASED: m = _mm_cmpgt_epi8(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias)); break;
+            case SEARCH_DECREASED: m = _mm_cmpgt_epi8(_mm_xor_si128(b, bias), _mm_xor_si128(a, bias)); break;
+            default: m = _mm_cmpeq_epi8(a, val); break;
+        }
+        cand = _mm_and_si128(cand, m);
+        _mm_store_si128((__m128i*) &candidates[i], cand);
+        count += __builtin_popcount(_mm_movemask_epi8(cand));
+    }
+    return count;
+}
+
+__attribute__((target("avx2")))
+static int filter_mask_avx2(uint8_t* candidates, const uint8_t* cur, const uint8_t* prev,
+                            SearchPredicate pred, uint8_t value) {
+    const __m256i ones = _mm256_set1_epi8(-1);
+    const __m256i bias = _mm256_set1_epi8((char) 0x80);
+    const __m256i val = _mm256_set1_epi8((char) value);
+    int count = 0;
+
+    for (int i = 0; i < RAM_SIZE; i += 32) {
+        __m256i cand = _mm256_load_si256((const __m256i*) &candidates[i]);
+        __m256i a = _mm256_loadu_si256((const __m256i*) &cur[i]);
+        __m256i b = _mm256_loadu_si256((const __m256i*) &prev[i]);
+        __m256i m;
+        switch (pred) {
+            case SEARCH_EQUAL: m = _mm256_cmpeq_epi8(a, b); break;
+            case SEARCH_CHANGED: m = _mm256_xor_si256(_mm256_cmpeq_epi8(a, b), ones); break;
+            case SEARCH_INCREASED: m = _mm256_cmpgt_epi8(_mm256_xor_si256(a, bias), _mm256_xor_si256(b, bias)); break;
+            case SEARCH_DECREASED: m = _mm256_cmpgt_epi8(_mm256_xor_si256(b, bias), _mm256_xor_si256(a, bias)); break;
+            default: m = _mm256_cmpeq_epi8(a, val); break;
+        }
+        cand = _mm256_and_si256(cand, m);
+        _mm256_store_si256((__m256i*) &candidates[i], cand);
+        count += __builtin_popcount(_mm256_movemask_epi8(cand));
+    }
+    return count;
+}
+#endif
+
+// Narrows the candidates with one (cur, prev) pair. prev may be null for
+// SEARCH_VALUE.
+static void filter_pair(RamSearch* search, const uint8_t* cur, const uint8_t* prev,
+                        SearchPredicate pred, uint8_t value) {
+    if (!prev)
+        prev = cur;
+
+    if (search->count <= SEARCH_LIST_MAX) {
+        int n = 0;
+        for (int i = 0; i < search->count; i++) {
+            uint16_t addr = search->list[i];
+            if (test_scalar(cur[addr], prev[addr], pred, value))
+                search->list[n++] = addr;
+        }
+        search->count = n;
+        return;
+    }
+
+#ifdef CHIP8_X86
+    if (search->simd == SIMD_AVX2)
+        search->count = filter_mask_avx2(search->candidates, cur, prev, pred, value);
+    else if (search->simd == SIMD_SSE2)
+        search->count = filter_mask_sse2(search->candidates, cur, prev, pred, value);
+    else
+#endif
+    search->count = filter_mask_scalar(search->candidates, cur, prev, pred, value);
+
+    if (search->count <= SEARCH_LIST_MAX) {
+        int n = 0;
+        for (int i = 0; i < RAM_SIZE && n < search->count; i++)
+            if (search->candidates[i]) search->list[n++] = i;
+    }
+}
+
+// Compares ram with the previous snapshot handed to the search. The first
+// snapshot only becomes the baseline, unless pred is SEARCH_VALUE.
+void ramsearch_filter(RamSearch* search, const uint8_t* ram, SearchPredicate pred, uint8_t value) {
+    if (search->has_previous || pred == SEARCH_VALUE)
+        filter_pair(search, ram, search->has_previous ? search->previous : nullptr, pred, value);
+    memcpy(search->previous, ram, RAM_SIZE);
+    search->has_previous = true;
+}
+
+// Applies pred between each pair of successive states, oldest first.
+void ramsearch_filter_states(RamSearch* search, const Chip8State* states, int n, SearchPredicate pred, uint8_t value) {
+    if (n <= 0)
+        return;
+
+    const uint8_t* prev = search->has_previous ? search->previous : nullptr;
+    for (int i = 0; i < n && search->count > 0; i++) {
+        if (prev || pred == SEARCH_VALUE)
+            filter_pair(search, states[i].RAM, prev, pred, value);
+        prev = states[i].RAM;
+    }
+    memcpy(search->previous, states[n - 1].RAM, RAM_SIZE);
+    search->has_previous = true;
+}
+
+int ramsearch_results(const RamSearch* search, uint16_t* addrs, int max) {
+    int n = 0;
+    if (search->count <= SEARCH_LIST_MAX) {
+        for (; n < search->count && n < max; n++)
+            addrs[n] = search->list[n];
+        return n;
+    }
+    for (int i = 0; i < RAM_SIZE && n < max; i++)
+        if (search->candidates[i]) addrs[n++] = i;
+    return n;
+}
+
+int cheats_add(CheatList* list, uint16_t addr, uint8_t value, bool freeze) {
+    addr &= RAM_SIZE - 1;
+    for (int i = 0; i < list->count; i++) {
+        if (list->cheats[i].addr == addr) {
+            list->cheats[i] = {addr, value, freeze};
+            return 0;
+        }
+    }
+    if (list->count >= MAX_CHEATS)
+        return 1;
+    list->cheats[list->count++] = {addr, value, freeze};
+    return 0;
+}
+
+void cheats_remove(CheatList* list, uint16_t addr) {
+    addr &= RAM_SIZE - 1;
+    for (int i = 0; i < list->count; i++) {
+        if (list->cheats[i].addr == addr) {
+            list->cheats[i] = list->cheats[--list->count];
+            return;
+        }
+    }
+}
+
+// Called once per frame. One-shot pokes are dropped after they are written.
+void cheats_apply(CheatList* list, Chip8* chip8) {
+    for (int i = 0; i < list->count;) {
+        Cheat* c = &list->cheats[i];
+        chip8->poke(c->addr, c->value);
+        if (c->freeze) {
+            i++;
+            continue;
+        }
+        *c = list->cheats[--list->count];
+    }
+}
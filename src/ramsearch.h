@@ -0,0 +1,60 @@
+#ifndef CHIP8EMULATOR_RAMSEARCH_H
+#define CHIP8EMULATOR_RAMSEARCH_H
+
+#include "chip8.h"
+#include "simd.h"
+
+#define SEARCH_LIST_MAX 64 // below this many candidates, filter per address
+#define MAX_CHEATS 64
+
+typedef enum {
+    SEARCH_EQUAL,       // same as in the previous snapshot
+    SEARCH_CHANGED,
+    SEARCH_INCREASED,
+    SEARCH_DECREASED,
+    SEARCH_VALUE,       // equals the given value
+} SearchPredicate;
+
+/*
+ * Cheat-finder style narrowing of RAM addresses. Every filter call compares
+ * a snapshot with the one before it and drops addresses that fail the
+ * predicate. The candidate set is a byte mask over the whole RAM so the
+ * compares run as SIMD kernels; once few addresses remain it switches to a
+ * list and only looks at those.
+ */
+typedef struct {
+    alignas(32) uint8_t candidates[RAM_SIZE]; // 0xFF while the address is a candidate
+    alignas(32) uint8_t previous[RAM_SIZE];
+    bool has_previous;
+
+    uint16_t list[SEARCH_LIST_MAX];
+    int count;
+    SimdLevel simd;
+} RamSearch;
+
+void ramsearch_reset(RamSearch* search);
+
+void ramsearch_filter(RamSearch* search, const uint8_t* ram, SearchPredicate pred, uint8_t value);
+
+void ramsearch_filter_states(RamSearch* search, const Chip8State* states, int n, SearchPredicate pred, uint8_t value);
+
+int ramsearch_results(const RamSearch* search, uint16_t* addrs, int max);
+
+typedef struct {
+    uint16_t addr;
+    uint8_t value;
+    bool freeze; // rewrite every frame instead of once
+} Cheat;
+
+typedef struct {
+    Cheat cheats[MAX_CHEATS];
+    int count;
+} CheatList;
+
+int cheats_add(CheatList* list, uint16_t addr, uint8_t value, bool freeze);
+
+void cheats_remove(CheatList* list, uint16_t addr);
+
+void cheats_apply(CheatList* list, Chip8* chip8);
+
+#endif //CHIP8EMULATOR_RAMSEARCH_H
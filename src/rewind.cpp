@@ -0,0 +1,151 @@
+#include "rewind.h"
+
+// worst case: every byte is a literal, plus one run header and the two lengths
+#define RECORD_MAX (sizeof(Chip8State) + 4 + 8)
+
+int rewind_create(Rewind* rw, size_t budget) {
+    *rw = {};
+    if (budget < RECORD_MAX)
+        return 1;
+
+    rw->ring = (uint8_t*) malloc(budget);
+    rw->capacity = budget;
+    rw->states = (Chip8State*) calloc(2, sizeof(Chip8State));
+    rw->scratch = (uint8_t*) malloc(RECORD_MAX);
+    if (!rw->ring || !rw->states || !rw->scratch) {
+        rewind_destroy(rw);
+        return 1;
+    }
+    rw->current = rw->states;
+    rw->next = rw->states + 1;
+    return 0;
+}
+
+void rewind_destroy(Rewind* rw) {
+    free(rw->ring);
+    free(rw->states);
+    free(rw->scratch);
+    *rw = {};
+}
+
+void rewind_clear(Rewind* rw) {
+    rw->head = 0;
+    rw->used = 0;
+    rw->frames = 0;
+    rw->has_current = false;
+}
+
+static void ring_write(Rewind* rw, size_t pos, const uint8_t* src, size_t n) {
+    pos %= rw->capacity;
+    size_t first = std::min(n, rw->capacity - pos);
+    memcpy(rw->ring + pos, src, first);
+    memcpy(rw->ring, src + first, n - first);
+}
+
+static void ring_read(const Rewind* rw, size_t pos, uint8_t* dst, size_t n) {
+    pos %= rw->capacity;
+    size_t first = std::min(n, rw->capacity - pos);
+    memcpy(dst, rw->ring + pos, first);
+    memcpy(dst + first, rw->ring, n - first);
+}
+
+// Run-length encodes a ^ b into out as (uint16 skip, uint16 length, bytes)
+// runs. Equal stretches are skipped eight bytes at a time.
+static size_t encode_delta(const uint8_t* a, const uint8_t* b, size_t n, uint8_t* out) {
+    size_t pos = 0;
+    size_t o = 0;
+    while (pos < n) {
+        size_t start = pos;
+        while (pos + 8 <= n) {
+            uint64_t x, y;
+            memcpy(&x, a + pos, 8);
+            memcpy(&y, b + pos, 8);
+            if (x != y)
+                break;
+            pos += 8;
+        }
+        while (pos < n && a[pos] == b[pos])
+            pos++;
+        if (pos == n)
+            break;
+
+        size_t last = pos;
+        for (size_t i = pos + 1; i < n && i - last <= REWIND_RLE_GAP; i++)
+            if (a[i] != b[i]) last = i;
+
+        uint16_t header[2] = {(uint16_t) (pos - start), (uint16_t) (last - pos + 1)};
+        memcpy(out + o, header, 4);
+        o += 4;
+        for (size_t i = pos; i <= last; i++)
+            out[o++] = a[i] ^ b[i];
+        pos = last + 1;
+    }
+    return o;
+}
+
+static void apply_delta(uint8_t* dst, const uint8_t* delta, size_t len) {
+    size_t pos = 0;
+    size_t o = 0;
+    while (o < len) {
+        uint16_t header[2];
+        memcpy(header, delta + o, 4);
+        o += 4;
+        pos += header[0];
+        for (int i = 0; i < header[1]; i++)
+            dst[pos++] ^= delta[o++];
+    }
+}
+
+// Drops the oldest record; nothing steps back past it any more.
+static void evict_oldest(Rewind* rw) {
+    uint32_t len;
+    ring_read(rw, rw->head, (uint8_t*) &len, 4);
+
+    rw->head = (rw->head + len + 8) % rw->capacity;
+    rw->used -= len + 8;
+    rw->frames--;
+}
+
+// Captures the machine as the newest frame of history. Call once per frame.
+void rewind_push(Rewind* rw, const Chip8* chip8) {
+    if (!rw->has_current) {
+        chip8->save_state(rw->current);
+        rw->has_current = true;
+        return;
+    }
+
+    chip8->save_state(rw->next);
+    uint32_t len = encode_delta((uint8_t*) rw->next, (uint8_t*) rw->current, sizeof(Chip8State), rw->scratch + 4);
+    std::swap(rw->current, rw->next);
+
+    // an unchanged frame still takes a record, so one step back is one frame
+    while (rw->used + len + 8 > rw->capacity)
+        evict_oldest(rw);
+
+    memcpy(rw->scratch, &len, 4);
+    memcpy(rw->scratch + 4 + len, &len, 4);
+    ring_write(rw, rw->head + rw->used, rw->scratch, len + 8);
+    rw->used += len + 8;
+    rw->frames++;
+}
+
+// Restores the frame before the newest one. Returns 1 once the history is
+// exhausted, leaving chip8 on the oldest state kept.
+int rewind_step_back(Rewind* rw, Chip8* chip8) {
+    if (rw->frames == 0) {
+        if (rw->has_current)
+            chip8->load_state(rw->current);
+        return 1;
+    }
+
+    uint32_t len;
+    size_t tail = rw->head + rw->used;
+    ring_read(rw, tail - 4, (uint8_t*) &len, 4);
+    ring_read(rw, tail - 4 - len, rw->scratch, len);
+    apply_delta((uint8_t*) rw->current, rw->scratch, len);
+
+    rw->used -= len + 8;
+    rw->frames--;
+    chip8->load_state(rw->current);
+    return 0;
+}
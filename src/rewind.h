@@ -0,0 +1,43 @@
+#ifndef CHIP8EMULATOR_REWIND_H
+#define CHIP8EMULATOR_REWIND_H
+
+#include "chip8.h"
+
+#define REWIND_DEFAULT_MB 8 // about ten minutes of typical play
+#define REWIND_RLE_GAP 4    // unchanged bytes a literal run may swallow
+
+/*
+ * Rewind history of one snapshot per frame under a fixed memory budget.
+ *
+ * Every capture is stored as the XOR of the new Chip8State against the one
+ * before it, run-length encoded as (skip, length, bytes) runs, in a byte ring.
+ * Applying the newest record to `current` steps back one frame. When the ring
+ * runs out of space the oldest records are simply dropped, since history is
+ * only ever walked back from `current`. Each record carries its length at
+ * both ends so the ring can be walked from either side.
+ */
+typedef struct {
+    uint8_t* ring;
+    size_t capacity;
+    size_t head;       // offset of the oldest record
+    size_t used;
+    int frames;        // records in the ring, i.e. how far back we can go
+
+    Chip8State* states;  // backs current and next
+    Chip8State* current; // state after the newest record
+    Chip8State* next;    // capture scratch
+    uint8_t* scratch;    // one encoded record
+    bool has_current;
+} Rewind;
+
+int rewind_create(Rewind* rw, size_t budget);
+
+void rewind_destroy(Rewind* rw);
+
+void rewind_clear(Rewind* rw);
+
+void rewind_push(Rewind* rw, const Chip8* chip8);
+
+int rewind_step_back(Rewind* rw, Chip8* chip8);
+
+#endif //CHIP8EMULATOR_REWIND_H
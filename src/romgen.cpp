@@ -0,0 +1,235 @@
+#include "romgen.h"
+
+// V1-VD are free for block bodies; V0 is the BNNN offset and SMC carrier,
+// VE counts loop iterations and VF is clobbered by arithmetic.
+#define LOOP_REG 0xE
+
+typedef struct {
+    uint8_t* rom;
+    int len;
+    std::mt19937_64* gen;
+} Emitter;
+
+static const char* names[WORKLOAD_COUNT] = {"alu", "call", "sprite", "mem", "jump", "smc"};
+
+const char* workload_name(Workload w) {
+    return w < WORKLOAD_COUNT ? names[w] : "unknown";
+}
+
+int workload_parse(const char* name, Workload* w) {
+    for (int i = 0; i < WORKLOAD_COUNT; i++) {
+        if (!strcmp(name, names[i])) {
+            *w = (Workload) i;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static uint16_t here(const Emitter* e) {
+    return PC_OFFSET + e->len;
+}
+
+static void emit(Emitter* e, uint16_t op) {
+    e->rom[e->len++] = op >> 8;
+    e->rom[e->len++] = op & 0xFF;
+}
+
+static void patch(Emitter* e, uint16_t addr, uint16_t op) {
+    e->rom[addr - PC_OFFSET] = op >> 8;
+    e->rom[addr - PC_OFFSET + 1] = op & 0xFF;
+}
+
+static int rand_range(Emitter* e, int lo, int hi) {
+    return lo + (int) ((*e->gen)() % (hi - lo + 1));
+}
+
+static int rand_reg(Emitter* e) {
+    return rand_range(e, 1, 0xD);
+}
+
+// One random arithmetic instruction on the free registers.
+static void emit_alu_op(Emitter* e) {
+    static const uint8_t ops[] = {0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0xE};
+    int x = rand_reg(e);
+    switch (rand_range(e, 0, 5)) {
+        case 0:
+            emit(e, 0x6000 | x << 8 | rand_range(e, 0, 0xFF));
+            break;
+        case 1:
+            emit(e, 0x7000 | x << 8 | rand_range(e, 0, 0xFF));
+            break;
+        default:
+            emit(e, 0x8000 | x << 8 | rand_reg(e) << 4 | ops[rand_range(e, 0, sizeof(ops) - 1)]);
+            break;
+    }
+}
+
+// Closes a counted loop opened at `top`: VE -= 1, repeat while non-zero.
+static void emit_loop_end(Emitter* e, uint16_t top) {
+    emit(e, 0x7000 | LOOP_REG << 8 | 0xFF);
+    emit(e, 0x3000 | LOOP_REG << 8 | 0x00);
+    emit(e, 0x1000 | top);
+}
+
+static void block_alu(Emitter* e) {
+    emit(e, 0x6000 | LOOP_REG << 8 | rand_range(e, 8, 32));
+    uint16_t top = here(e);
+    int n = rand_range(e, 4, 24);
+    for (int i = 0; i < n; i++)
+        emit_alu_op(e);
+    emit_loop_end(e, top);
+}
+
+// Subroutines sit inline behind a jump; each calls the next one down.
+static void block_call(Emitter* e) {
+    int depth = rand_range(e, 2, ROMGEN_MAX_CALL_DEPTH);
+    uint16_t skip = here(e);
+    emit(e, 0x0000);
+
+    uint16_t callee = 0;
+    for (int d = 0; d < depth; d++) {
+        uint16_t entry = here(e);
+        int n = rand_range(e, 0, 4);
+        for (int i = 0; i < n; i++)
+            emit_alu_op(e);
+        if (callee)
+            emit(e, 0x2000 | callee);
+        emit(e, 0x00EE);
+        callee = entry;
+    }
+    patch(e, skip, 0x1000 | here(e));
+
+    emit(e, 0x6000 | LOOP_REG << 8 | rand_range(e, 2, 8));
+    uint16_t top = here(e);
+    emit(e, 0x2000 | callee);
+    emit_loop_end(e, top);
+}
+
+// Random sprite rows inline, then draws clustered on the right and bottom
+// edges, plus coordinates past them that wrap around before clipping.
+static void block_sprite(Emitter* e) {
+    int rows = rand_range(e, 1, 15);
+    uint16_t skip = here(e);
+    emit(e, 0x0000);
+    uint16_t data = here(e);
+    for (int i = 0; i < rows; i++)
+        e->rom[e->len++] = (uint8_t) rand_range(e, 1, 0xFF);
+    if (e->len & 1)
+        e->rom[e->len++] = 0;
+    patch(e, skip, 0x1000 | here(e));
+
+    emit(e, 0xA000 | data);
+    if (rand_range(e, 0, 3) == 0)
+        emit(e, 0x00E0);
+    int draws = rand_range(e, 2, 8);
+    for (int i = 0; i < draws; i++) {
+        int x, y;
+        switch (rand_range(e, 0, 3)) {
+            case 0: x = rand_range(e, SCREEN_WIDTH - 8, SCREEN_WIDTH - 1); y = rand_range(e, 0, SCREEN_HEIGHT - 1); break;
+            case 1: x = rand_range(e, 0, SCREEN_WIDTH - 1); y = rand_range(e, SCREEN_HEIGHT - rows, SCREEN_HEIGHT - 1); break;
+            case 2: x = rand_range(e, SCREEN_WIDTH, 0xFF); y = rand_range(e, SCREEN_HEIGHT, 0xFF); break;
+            default: x = SCREEN_WIDTH - 1; y = SCREEN_HEIGHT - 1; break;
+        }
+        emit(e, 0x6100 | x);
+        emit(e, 0x6200 | y);
+        emit(e, 0xD120 | rows);
+    }
+}
+
+static void block_mem(Emitter* e) {
+    emit(e, 0x6000 | LOOP_REG << 8 | rand_range(e, 4, 16));
+    uint16_t top = here(e);
+    int n = rand_range(e, 2, 6);
+    for (int i = 0; i < n; i++) {
+        int x = rand_range(e, 0, 0xD);
+        switch (rand_range(e, 0, 2)) {
+            case 0:
+                emit(e, 0xA000 | (ROMGEN_SCRATCH + rand_range(e, 0, 0xFF - x)));
+                emit(e, 0xF055 | x << 8);
+                break;
+            case 1:
+                emit(e, 0xA000 | (ROMGEN_SCRATCH + rand_range(e, 0, 0xFF - x)));
+                emit(e, 0xF065 | x << 8);
+                break;
+            default:
+                emit(e, 0xA000 | (ROMGEN_SCRATCH + rand_range(e, 0, 0xFD)));
+                emit(e, 0xF033 | x << 8);
+                break;
+        }
+        emit_alu_op(e);
+    }
+    emit_loop_end(e, top);
+}
+
+// V0 = 2 * VE picks the entry; entries are single instructions that fall
+// through to the end of the table, Duff's device style.
+static void block_jump(Emitter* e) {
+    int entries = rand_range(e, 2, 16);
+    emit(e, 0x6000 | LOOP_REG << 8 | entries);
+    uint16_t top = here(e);
+    emit(e, 0x8000 | LOOP_REG << 4);     // V0 = VE
+    emit(e, 0x8004);                     // V0 += V0
+    uint16_t jump = here(e);
+    emit(e, 0x0000);
+    uint16_t table = here(e);
+    for (int i = 0; i <= entries; i++)
+        emit_alu_op(e);
+    patch(e, jump, 0xB000 | table);
+    emit_loop_end(e, top);
+}
+
+// Stores V0 into the immediate of a later LD and then runs it.
+static void block_smc(Emitter* e) {
+    int x = rand_reg(e);
+    int y = rand_reg(e);
+    emit(e, 0x6000 | LOOP_REG << 8 | rand_range(e, 4, 16));
+    uint16_t top = here(e);
+    emit(e, 0x7000 | y << 8 | rand_range(e, 1, 0xFF));
+    emit(e, 0x8000 | y << 4);            // V0 = VY
+    uint16_t store = here(e);
+    emit(e, 0x0000);
+    emit(e, 0xF055);
+    uint16_t slot = here(e);
+    emit(e, 0x6000 | x << 8);
+    patch(e, store, 0xA000 | (slot + 1));
+    emit(e, 0x8003 | rand_reg(e) << 8 | x << 4);
+    emit_loop_end(e, top);
+}
+
+int romgen_generate(const RomGenConfig* cfg, uint8_t* rom, int* size) {
+    int total = 0;
+    for (int w : cfg->mix) {
+        if (w < 0)
+            return 1;
+        total += w;
+    }
+    if (total == 0 || cfg->size < ROMGEN_BLOCK_MAX || cfg->size > ROMGEN_MAX_SIZE)
+        return 1;
+
+    std::mt19937_64 gen(cfg->seed);
+    Emitter e = {rom, 0, &gen};
+    memset(rom, 0, cfg->size);
+
+    uint16_t loop = here(&e);
+    do {
+        int pick = (int) (gen() % total);
+        int w = 0;
+        while (pick >= cfg->mix[w])
+            pick -= cfg->mix[w++];
+
+        switch ((Workload) w) {
+            case WORKLOAD_ALU: block_alu(&e); break;
+            case WORKLOAD_CALL: block_call(&e); break;
+            case WORKLOAD_SPRITE: block_sprite(&e); break;
+            case WORKLOAD_MEM: block_mem(&e); break;
+            case WORKLOAD_JUMP: block_jump(&e); break;
+            case WORKLOAD_SMC: block_smc(&e); break;
+            default: break;
+        }
+    } while (e.len + ROMGEN_BLOCK_MAX + 2 <= cfg->size); // room for one more block and the closing jump
+    emit(&e, 0x1000 | loop);
+
+    *size = e.len;
+    return 0;
+}
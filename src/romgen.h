@@ -0,0 +1,39 @@
+#ifndef CHIP8EMULATOR_ROMGEN_H
+#define CHIP8EMULATOR_ROMGEN_H
+
+#include "chip8.h"
+
+#define ROMGEN_MAX_SIZE 0xD00     // code stays below the scratch page
+#define ROMGEN_SCRATCH 0xF00      // FX55/FX33 targets live in 0xF00-0xFFF
+#define ROMGEN_BLOCK_MAX 256      // upper bound on one block's encoded size
+#define ROMGEN_MAX_CALL_DEPTH 14
+
+typedef enum {
+    WORKLOAD_ALU,     // 8XYN/7XNN loops
+    WORKLOAD_CALL,    // nested 2NNN/00EE chains
+    WORKLOAD_SPRITE,  // DXYN at and past the screen edges
+    WORKLOAD_MEM,     // FX55/FX65/FX33 traffic in the scratch page
+    WORKLOAD_JUMP,    // BNNN into unrolled tables
+    WORKLOAD_SMC,     // code that rewrites its own immediates
+    WORKLOAD_COUNT,
+} Workload;
+
+typedef struct {
+    int size;                    // target ROM size in bytes
+    int mix[WORKLOAD_COUNT];     // relative weight of each block kind
+    uint64_t seed;
+} RomGenConfig;
+
+/*
+ * Synthetic workload ROMs. A program is a main loop of blocks drawn from the
+ * weighted mix; every block terminates on its own, keeps I inside RAM and the
+ * call depth inside the stack, so a generated ROM runs forever without
+ * faulting. The same config always produces the same bytes.
+ */
+int romgen_generate(const RomGenConfig* cfg, uint8_t* rom, int* size);
+
+const char* workload_name(Workload w);
+
+int workload_parse(const char* name, Workload* w);
+
+#endif //CHIP8EMULATOR_ROMGEN_H
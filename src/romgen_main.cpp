@@ -0,0 +1,97 @@
+#include "romgen.h"
+
+#include <charconv>
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [options] <out.ch8>\n"
+            "  --size N          ROM size in bytes, %d-%d (default: 2048)\n"
+            "  --seed N          generator seed (default: 1)\n"
+            "  --mix NAME=W,...  block weights; names are alu, call, sprite, mem, jump, smc\n"
+            "  --workload NAME   shorthand for --mix NAME=1\n",
+            prog, ROMGEN_BLOCK_MAX, ROMGEN_MAX_SIZE);
+}
+
+static int parse_int(const char* text, uint64_t* value) {
+    const char* end = text + strlen(text);
+    auto res = std::from_chars(text, end, *value);
+    return res.ec != std::errc() || res.ptr != end;
+}
+
+// "alu=3,sprite=1"
+static int parse_mix(const char* text, int* mix) {
+    memset(mix, 0, WORKLOAD_COUNT * sizeof(int));
+    std::string spec = text;
+    size_t start = 0;
+    while (start <= spec.size()) {
+        size_t end = spec.find(',', start);
+        if (end == std::string::npos)
+            end = spec.size();
+        std::string item = spec.substr(start, end - start);
+        size_t eq = item.find('=');
+        Workload w;
+        uint64_t weight;
+        if (eq == std::string::npos || workload_parse(item.substr(0, eq).c_str(), &w)
+            || parse_int(item.c_str() + eq + 1, &weight) || weight > 1000)
+            return 1;
+        mix[w] = (int) weight;
+        start = end + 1;
+    }
+    return 0;
+}
+
+// Writes one generated ROM; the CTest workloads are built with this.
+int main(int argc, char* argv[]) {
+    RomGenConfig cfg = {2048, {}, 1};
+    for (int& w : cfg.mix)
+        w = 1;
+    const char* out = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        uint64_t value;
+        if (arg[0] != '-') {
+            out = argv[i];
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        const char* next = argv[++i];
+        Workload w;
+
+        if (arg == "--size" && !parse_int(next, &value) && value <= ROMGEN_MAX_SIZE) {
+            cfg.size = (int) value;
+        } else if (arg == "--seed" && !parse_int(next, &value)) {
+            cfg.seed = value;
+        } else if (arg == "--mix" && !parse_mix(next, cfg.mix)) {
+            continue;
+        } else if (arg == "--workload" && !workload_parse(next, &w)) {
+            memset(cfg.mix, 0, sizeof(cfg.mix));
+            cfg.mix[w] = 1;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!out) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    uint8_t rom[ROMGEN_MAX_SIZE];
+    int size;
+    if (romgen_generate(&cfg, rom, &size)) {
+        fprintf(stderr, "Error: invalid size or mix\n");
+        return 1;
+    }
+
+    std::ofstream file(out, std::ios::binary);
+    file.write((const char*) rom, size);
+    if (!file) {
+        fprintf(stderr, "Error: could not write %s\n", out);
+        return 1;
+    }
+    return 0;
+}
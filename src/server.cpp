@@ -0,0 +1,452 @@
+#include "server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <unordered_set>
+
+// Builds the MSG_FRAME for a finished CMD_STEP. Runs on the worker so the
+// event loop only has to copy bytes to the socket.
+void encode_frame_delta(Session* session, int result) {
+    const uint8_t* screen = session->chip8.screen_dump();
+    uint16_t changed[SERVER_DELTA_LIST_MAX];
+    uint8_t bitmap[SCREEN_SIZE / 8] = {};
+    int count = 0;
+
+    for (int i = 0; i < SCREEN_SIZE; i++) {
+        if (screen[i] == session->last_sent[i])
+            continue;
+        if (count < SERVER_DELTA_LIST_MAX)
+            changed[count] = i;
+        bitmap[i >> 3] |= 1 << (i & 7);
+        count++;
+    }
+    memcpy(session->last_sent, screen, SCREEN_SIZE);
+
+    bool use_list = count <= SERVER_DELTA_LIST_MAX;
+    uint16_t payload_len = 2 + (use_list ? 2 + count * 2 : sizeof(bitmap));
+    MsgHeader hdr = {MSG_FRAME, 0, payload_len, session->id};
+
+    std::string& out = session->reply;
+    out.clear();
+    out.append((const char*) &hdr, sizeof(hdr));
+    out.push_back((char) (int8_t) result);
+    out.push_back((char) (use_list ? DELTA_LIST : DELTA_BITMAP));
+    if (use_list) {
+        uint16_t n = count;
+        out.append((const char*) &n, 2);
+        out.append((const char*) changed, count * 2);
+    } else {
+        out.append((const char*) bitmap, sizeof(bitmap));
+    }
+}
+
+Chip8Server::Chip8Server() : listen_fd(-1), epoll_fd(-1), wake_fd(-1), next_session(1), running(false) {}
+
+Chip8Server::~Chip8Server() {
+    {
+        std::lock_guard<std::mutex> guard(this->queue_lock);
+        this->running = false;
+    }
+    this->queue_cv.notify_all();
+    for (auto& t : this->workers)
+        t.join();
+
+    // closed connections are only kept alive by their sessions out on a worker
+    std::unordered_set<Connection*> orphans;
+    for (auto& [id, session] : this->sessions) {
+        if (session->owner->closed)
+            orphans.insert(session->owner);
+        delete session;
+    }
+    for (Connection* conn : orphans)
+        delete conn;
+    for (auto& [fd, conn] : this->connections) {
+        close(fd);
+        delete conn;
+    }
+    if (this->listen_fd >= 0) {
+        close(this->listen_fd);
+        unlink(this->path.c_str());
+    }
+    if (this->wake_fd >= 0) close(this->wake_fd);
+    if (this->epoll_fd >= 0) close(this->epoll_fd);
+}
+
+int Chip8Server::start(const char* socket_path, int n_workers) {
+    sockaddr_un addr = {};
+    if (strlen(socket_path) >= sizeof(addr.sun_path))
+        return 1;
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+    this->path = socket_path;
+
+    // a peer going away mid-write must not kill every other session
+    signal(SIGPIPE, SIG_IGN);
+
+    this->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (this->listen_fd < 0)
+        return 1;
+    unlink(socket_path);
+    if (bind(this->listen_fd, (sockaddr*) &addr, sizeof(addr)) || listen(this->listen_fd, SOMAXCONN))
+        return 1;
+
+    this->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    this->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (this->epoll_fd < 0 || this->wake_fd < 0)
+        return 1;
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = this->listen_fd;
+    if (epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, this->listen_fd, &ev))
+        return 1;
+    ev.data.fd = this->wake_fd;
+    if (epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, this->wake_fd, &ev))
+        return 1;
+
+    if (n_workers < 1)
+        n_workers = 1;
+    this->running = true;
+    for (int i = 0; i < n_workers; i++)
+        this->workers.emplace_back(&Chip8Server::worker_loop, this);
+    return 0;
+}
+
+int Chip8Server::run() {
+    epoll_event events[SERVER_MAX_EVENTS];
+
+    while (this->running) {
+        int n = epoll_wait(this->epoll_fd, events, SERVER_MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 1;
+        }
+
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == this->listen_fd) {
+                accept_clients();
+                continue;
+            }
+            if (fd == this->wake_fd) {
+                uint64_t count;
+                while (read(this->wake_fd, &count, sizeof(count)) > 0) {}
+                collect_done();
+                continue;
+            }
+
+            auto it = this->connections.find(fd);
+            if (it == this->connections.end())
+                continue;
+            if (events[i].events & EPOLLOUT)
+                write_client(it->second);
+            // the write may have dropped the connection
+            it = this->connections.find(fd);
+            if (it == this->connections.end())
+                continue;
+            Connection* conn = it->second;
+            // a paused connection would report the hangup forever; nobody
+            // is left to read its replies, so drop it now
+            if (events[i].events & (EPOLLHUP | EPOLLERR) && !(conn->events & EPOLLIN))
+                close_client(conn);
+            else if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                read_client(conn);
+        }
+    }
+    return 0;
+}
+
+// Safe to call from a signal handler.
+void Chip8Server::stop() {
+    this->running = false;
+    uint64_t one = 1;
+    if (this->wake_fd >= 0)
+        write(this->wake_fd, &one, sizeof(one));
+}
+
+void Chip8Server::accept_clients() {
+    while (true) {
+        int fd = accept4(this->listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+
+        auto* conn = new Connection{fd, {}, {}, 0, false, false, EPOLLIN};
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, fd, &ev)) {
+            close(fd);
+            delete conn;
+            continue;
+        }
+        this->connections[fd] = conn;
+    }
+}
+
+void Chip8Server::read_client(Connection* conn) {
+    char buff[16384];
+    while (true) {
+        // a blocked connection is not parsed, so stop taking input and let
+        // the socket buffer push back on the client
+        if (conn->blocked && conn->in.size() >= SERVER_MAX_INPUT) {
+            update_events(conn);
+            return;
+        }
+        ssize_t n = read(conn->fd, buff, sizeof(buff));
+        if (n > 0) {
+            conn->in.append(buff, n);
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (n < 0 && errno == EINTR)
+            continue;
+        close_client(conn);
+        return;
+    }
+    process_input(conn);
+}
+
+void Chip8Server::write_client(Connection* conn) {
+    while (!conn->out.empty()) {
+        ssize_t n = write(conn->fd, conn->out.data(), conn->out.size());
+        if (n > 0) {
+            conn->out.erase(0, n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        close_client(conn);
+        return;
+    }
+    update_events(conn);
+}
+
+void Chip8Server::update_events(Connection* conn) {
+    uint32_t events = 0;
+    if (!conn->blocked || conn->in.size() < SERVER_MAX_INPUT)
+        events |= EPOLLIN;
+    if (!conn->out.empty())
+        events |= EPOLLOUT;
+    if (events == conn->events)
+        return;
+
+    epoll_event ev = {};
+    ev.events = events;
+    ev.data.fd = conn->fd;
+    epoll_ctl(this->epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev);
+    conn->events = events;
+}
+
+void Chip8Server::close_client(Connection* conn) {
+    if (conn->closed)
+        return;
+    conn->closed = true;
+    epoll_ctl(this->epoll_fd, EPOLL_CTL_DEL, conn->fd, nullptr);
+    close(conn->fd);
+    this->connections.erase(conn->fd);
+
+    // sessions still running on a worker are reaped in collect_done()
+    for (auto it = this->sessions.begin(); it != this->sessions.end();) {
+        Session* session = it->second;
+        if (session->owner == conn && !session->busy) {
+            delete session;
+            it = this->sessions.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (conn->busy_sessions == 0)
+        delete conn;
+}
+
+// Handles every complete message in the input buffer, in order. A message
+// addressed to a session that is still stepping stalls the connection until
+// the worker hands the session back.
+void Chip8Server::process_input(Connection* conn) {
+    size_t pos = 0;
+    conn->blocked = false;
+
+    while (conn->in.size() - pos >= SERVER_HEADER_SIZE) {
+        MsgHeader hdr;
+        memcpy(&hdr, conn->in.data() + pos, sizeof(hdr));
+        if (conn->in.size() - pos - SERVER_HEADER_SIZE < hdr.len)
+            break;
+
+        if (hdr.type != CMD_CREATE) {
+            auto it = this->sessions.find(hdr.session);
+            if (it != this->sessions.end() && it->second->owner == conn && it->second->busy) {
+                conn->blocked = true;
+                break;
+            }
+        }
+
+        auto* payload = (const uint8_t*) conn->in.data() + pos + SERVER_HEADER_SIZE;
+        pos += SERVER_HEADER_SIZE + hdr.len;
+        if (handle_message(conn, &hdr, payload)) {
+            close_client(conn);
+            return;
+        }
+    }
+    conn->in.erase(0, pos);
+
+    if (!conn->out.empty())
+        write_client(conn);
+    else
+        update_events(conn);
+}
+
+int Chip8Server::handle_message(Connection* conn, const MsgHeader* hdr, const uint8_t* payload) {
+    if (hdr->type == CMD_CREATE) {
+        uint32_t freq;
+        uint8_t plt;
+        uint64_t seed;
+        if (hdr->len != 13)
+            return 1;
+        memcpy(&freq, payload, 4);
+        plt = payload[4];
+        memcpy(&seed, payload + 5, 8);
+        if (plt > P_SCHIP_1_1)
+            plt = P_CHIP8;
+        // the constructor derives IPF from this, keep it at one or more
+        freq = std::clamp<uint32_t>(freq, LOOP_FREQ, SERVER_MAX_EMU_FREQ);
+
+        uint32_t id = this->next_session++;
+        auto* session = new Session{id, Chip8((int) freq, (Platform) plt, seed), conn, {}, 0, {}, false};
+        this->sessions[id] = session;
+        send_message(conn, MSG_CREATED, id, nullptr, 0);
+        return 0;
+    }
+
+    auto it = this->sessions.find(hdr->session);
+    if (it == this->sessions.end() || it->second->owner != conn) {
+        send_message(conn, MSG_ERROR, hdr->session, nullptr, 0);
+        return 0;
+    }
+    Session* session = it->second;
+
+    switch (hdr->type) {
+        case CMD_LOAD_ROM: {
+            int res = session->chip8.load_rom((unsigned char*) payload, hdr->len);
+            send_message(conn, res ? MSG_ERROR : MSG_OK, session->id, nullptr, 0);
+            break;
+        }
+
+        case CMD_KEYS: {
+            uint16_t mask;
+            if (hdr->len != 2)
+                return 1;
+            memcpy(&mask, payload, 2);
+            for (int i = 0; i < KEYPAD_SIZE; i++) {
+                if (mask & (1 << i)) session->chip8.press_key(i);
+                else session->chip8.release_key(i);
+            }
+            break;
+        }
+
+        case CMD_STEP: {
+            if (hdr->len != 2)
+                return 1;
+            memcpy(&session->frames, payload, 2);
+            session->busy = true;
+            conn->busy_sessions++;
+            {
+                std::lock_guard<std::mutex> guard(this->queue_lock);
+                this->jobs.push_back(session);
+            }
+            this->queue_cv.notify_one();
+            break;
+        }
+
+        case CMD_SNAPSHOT: {
+            // zeroed so the padding does not send out bytes of our stack
+            Chip8State state = {};
+            session->chip8.save_state(&state);
+            send_message(conn, MSG_SNAPSHOT, session->id, &state, sizeof(state));
+            break;
+        }
+
+        case CMD_DESTROY:
+            send_message(conn, MSG_OK, session->id, nullptr, 0);
+            destroy_session(session);
+            break;
+
+        default:
+            return 1;
+    }
+    return 0;
+}
+
+void Chip8Server::send_message(Connection* conn, uint8_t type, uint32_t session, const void* payload, uint16_t len) {
+    MsgHeader hdr = {type, 0, len, session};
+    conn->out.append((const char*) &hdr, sizeof(hdr));
+    if (len)
+        conn->out.append((const char*) payload, len);
+}
+
+void Chip8Server::destroy_session(Session* session) {
+    this->sessions.erase(session->id);
+    delete session;
+}
+
+// Hands finished sessions back to their connections. Runs on the event loop.
+void Chip8Server::collect_done() {
+    std::deque<Session*> finished;
+    {
+        std::lock_guard<std::mutex> guard(this->queue_lock);
+        finished.swap(this->done);
+    }
+
+    for (Session* session : finished) {
+        Connection* conn = session->owner;
+        session->busy = false;
+        conn->busy_sessions--;
+
+        if (conn->closed) {
+            destroy_session(session);
+            if (conn->busy_sessions == 0)
+                delete conn;
+            continue;
+        }
+
+        conn->out.append(session->reply);
+        if (conn->blocked)
+            process_input(conn);
+        else
+            write_client(conn);
+    }
+}
+
+void Chip8Server::worker_loop() {
+    while (true) {
+        Session* session;
+        {
+            std::unique_lock<std::mutex> guard(this->queue_lock);
+            this->queue_cv.wait(guard, [this] { return !this->jobs.empty() || !this->running; });
+            if (!this->running)
+                return;
+            session = this->jobs.front();
+            this->jobs.pop_front();
+        }
+
+        int res = 0;
+        for (int i = 0; i < session->frames && res == 0; i++)
+            res = session->chip8.run_frame();
+        encode_frame_delta(session, res);
+
+        {
+            std::lock_guard<std::mutex> guard(this->queue_lock);
+            this->done.push_back(session);
+        }
+        uint64_t one = 1;
+        write(this->wake_fd, &one, sizeof(one));
+    }
+}
@@ -0,0 +1,134 @@
+#ifndef CHIP8EMULATOR_SERVER_H
+#define CHIP8EMULATOR_SERVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include "chip8.h"
+
+/*
+ * Wire protocol. Every message in either direction starts with a fixed
+ * 8 byte header followed by `len` bytes of payload. All fields are in host
+ * byte order since clients share the machine with the server.
+ *
+ *   CMD_CREATE    u32 emu_freq, u8 platform, u64 seed   -> MSG_CREATED
+ *   CMD_LOAD_ROM  rom bytes                             -> MSG_OK / MSG_ERROR
+ *   CMD_KEYS      u16 keypad bitmask (bit i = key i)    -> (no reply)
+ *   CMD_STEP      u16 frames                            -> MSG_FRAME
+ *   CMD_SNAPSHOT  (empty)                               -> MSG_SNAPSHOT
+ *   CMD_DESTROY   (empty)                               -> MSG_OK
+ *
+ * MSG_FRAME carries an i8 cycle result (0 on success), a u8 delta format and
+ * the pixels which changed since the previous MSG_FRAME of that session:
+ *   DELTA_LIST    u16 count, count * u16 pixel index
+ *   DELTA_BITMAP  SCREEN_SIZE/8 bytes, bit set = pixel toggled
+ */
+
+#define SERVER_HEADER_SIZE 8
+#define SERVER_MAX_PAYLOAD 0xFFFF
+#define SERVER_MAX_EVENTS 256
+#define SERVER_DELTA_LIST_MAX 128
+#define SERVER_MAX_EMU_FREQ (LOOP_FREQ * 100000) // CMD_CREATE emu_freq is clamped to this
+#define SERVER_MAX_INPUT (4 * (SERVER_HEADER_SIZE + SERVER_MAX_PAYLOAD)) // buffered while blocked
+
+typedef enum : uint8_t {
+    CMD_CREATE = 0x01,
+    CMD_LOAD_ROM,
+    CMD_KEYS,
+    CMD_STEP,
+    CMD_SNAPSHOT,
+    CMD_DESTROY,
+
+    MSG_OK = 0x80,
+    MSG_ERROR,
+    MSG_CREATED,
+    MSG_FRAME,
+    MSG_SNAPSHOT,
+} MsgType;
+
+typedef enum : uint8_t {
+    DELTA_LIST,
+    DELTA_BITMAP,
+} DeltaFormat;
+
+typedef struct {
+    uint8_t type;
+    uint8_t reserved;
+    uint16_t len;
+    uint32_t session;
+} MsgHeader;
+
+static_assert(sizeof(MsgHeader) == SERVER_HEADER_SIZE);
+
+struct Connection;
+
+struct Session {
+    uint32_t id;
+    Chip8 chip8;
+    Connection* owner;
+
+    uint8_t last_sent[SCREEN_SIZE]; // screen as of the previous MSG_FRAME
+    uint16_t frames;                // frames requested by the pending CMD_STEP
+    std::string reply;              // MSG_FRAME built by the worker
+    bool busy;
+};
+
+struct Connection {
+    int fd;
+    std::string in;
+    std::string out;
+    int busy_sessions;  // sessions owned by this connection out on a worker
+    bool blocked;       // input parsing stalled on a busy session
+    bool closed;
+    uint32_t events;    // epoll events currently registered
+};
+
+class Chip8Server {
+    int listen_fd;
+    int epoll_fd;
+    int wake_fd;        // eventfd poked by workers and stop()
+    std::string path;
+
+    std::unordered_map<int, Connection*> connections;
+    std::unordered_map<uint32_t, Session*> sessions;
+    uint32_t next_session;
+
+    std::vector<std::thread> workers;
+    std::mutex queue_lock;
+    std::condition_variable queue_cv;
+    std::deque<Session*> jobs;
+    std::deque<Session*> done;
+
+    std::atomic<bool> running;
+
+public:
+    Chip8Server();
+    ~Chip8Server();
+
+    int start(const char* socket_path, int n_workers);
+    int run();
+    void stop();
+
+private:
+    void accept_clients();
+    void read_client(Connection* conn);
+    void write_client(Connection* conn);
+    void close_client(Connection* conn);
+    void update_events(Connection* conn);
+
+    void process_input(Connection* conn);
+    int handle_message(Connection* conn, const MsgHeader* hdr, const uint8_t* payload);
+    void send_message(Connection* conn, uint8_t type, uint32_t session, const void* payload, uint16_t len);
+    void destroy_session(Session* session);
+
+    void collect_done();
+    void worker_loop();
+};
+
+void encode_frame_delta(Session* session, int result);
+
+#endif //CHIP8EMULATOR_SERVER_H
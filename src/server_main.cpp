@@ -0,0 +1,32 @@
+#include "server.h"
+
+#include <csignal>
+
+static Chip8Server* server = nullptr;
+
+static void handle_signal(int) {
+    if (server) server->stop();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <socket path> [workers]" << std::endl;
+        return 1;
+    }
+
+    int n_workers = argc > 2 ? atoi(argv[2]) : (int) std::thread::hardware_concurrency();
+
+    server = new Chip8Server();
+    if (server->start(argv[1], n_workers)) {
+        std::cerr << "Error: could not listen on " << argv[1] << std::endl;
+        delete server;
+        return 1;
+    }
+
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+
+    int res = server->run();
+    delete server;
+    return res;
+}
@@ -0,0 +1,70 @@
+#include "shmexport.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// name is a POSIX shm name such as "/chip8". An existing object of that
+// name is replaced.
+int shmexport_create(ShmExport* ex, const char* name) {
+    ex->ring = nullptr;
+    if (name[0] != '/' || strlen(name) >= sizeof(ex->name))
+        return 1;
+    strcpy(ex->name, name);
+
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+        return 1;
+    if (ftruncate(fd, sizeof(ExportRing))) {
+        close(fd);
+        shm_unlink(name);
+        return 1;
+    }
+    void* mem = mmap(nullptr, sizeof(ExportRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        shm_unlink(name);
+        return 1;
+    }
+
+    // fresh pages are zero, which is already a valid empty ring
+    ex->ring = (ExportRing*) mem;
+    ex->ring->slots = SHM_EXPORT_SLOTS;
+    ex->ring->frame_size = sizeof(ExportFrame);
+    ex->ring->version = SHM_EXPORT_VERSION;
+    std::atomic_thread_fence(std::memory_order_release);
+    ex->ring->magic = SHM_EXPORT_MAGIC;
+    return 0;
+}
+
+// Copies the finished frame into its slot; a few hundred nanoseconds and
+// never blocks.
+void shmexport_publish(ShmExport* ex, Chip8* chip8, uint64_t frame) {
+    ExportFrame* slot = &ex->ring->frames[frame & (SHM_EXPORT_SLOTS - 1)];
+    uint32_t seq = slot->seq.load(std::memory_order_relaxed);
+
+    slot->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->frame = frame;
+    slot->PC = chip8->PC_dump();
+    slot->I = chip8->I_dump();
+    slot->SP = chip8->SP_dump();
+    slot->DT = chip8->delay_timer();
+    slot->ST = chip8->sound_timer();
+    memcpy(slot->V, chip8->reg_dump(), sizeof(slot->V));
+    memcpy(slot->stack, chip8->stack_view(), sizeof(slot->stack));
+    memcpy(slot->screen, chip8->screen_dump(), SCREEN_SIZE);
+
+    slot->seq.store(seq + 2, std::memory_order_release);
+    ex->ring->published.store(frame + 1, std::memory_order_release);
+}
+
+void shmexport_destroy(ShmExport* ex) {
+    if (!ex->ring)
+        return;
+    munmap(ex->ring, sizeof(ExportRing));
+    shm_unlink(ex->name);
+    ex->ring = nullptr;
+}
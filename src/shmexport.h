@@ -0,0 +1,55 @@
+#ifndef CHIP8EMULATOR_SHMEXPORT_H
+#define CHIP8EMULATOR_SHMEXPORT_H
+
+#include "chip8.h"
+
+#include <atomic>
+
+#define SHM_EXPORT_MAGIC 0x48533843 // "C8SH"
+#define SHM_EXPORT_VERSION 1
+#define SHM_EXPORT_SLOTS 16 // must be a power of two
+
+// One published frame. seq is odd while the emulator is writing the slot.
+typedef struct {
+    alignas(64) std::atomic<uint32_t> seq;
+    uint64_t frame;
+    uint16_t PC;
+    uint16_t I;
+    uint8_t SP;
+    uint8_t DT;
+    uint8_t ST;
+    uint8_t V[16];
+    uint16_t stack[16];
+    uint8_t screen[SCREEN_SIZE];
+} ExportFrame;
+
+/*
+ * Layout of the shared-memory object. Frame n goes to slot n % SLOTS and
+ * `published` counts frames written so far. The emulator never waits on
+ * readers: a reader that is too slow finds its frame overwritten, and a
+ * reader racing the writer sees seq change and retries (a seqlock).
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slots;
+    uint32_t frame_size;
+    alignas(64) std::atomic<uint64_t> published;
+    ExportFrame frames[SHM_EXPORT_SLOTS];
+} ExportRing;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+              "the ring is shared between processes, its atomics must not use locks");
+
+typedef struct {
+    ExportRing* ring;
+    char name[256];
+} ShmExport;
+
+int shmexport_create(ShmExport* ex, const char* name);
+
+void shmexport_publish(ShmExport* ex, Chip8* chip8, uint64_t frame);
+
+void shmexport_destroy(ShmExport* ex);
+
+#endif //CHIP8EMULATOR_SHMEXPORT_H
@@ -0,0 +1,93 @@
+#include "shmread.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+int shmreader_open(ShmReader* reader, const char* name) {
+    reader->ring = nullptr;
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return 1;
+    void* mem = mmap(nullptr, sizeof(ExportRing), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED)
+        return 1;
+
+    auto* ring = (const ExportRing*) mem;
+    if (ring->magic != SHM_EXPORT_MAGIC || ring->version != SHM_EXPORT_VERSION
+        || ring->slots != SHM_EXPORT_SLOTS || ring->frame_size != sizeof(ExportFrame)) {
+        munmap(mem, sizeof(ExportRing));
+        return 1;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    reader->ring = ring;
+    return 0;
+}
+
+void shmreader_close(ShmReader* reader) {
+    if (reader->ring)
+        munmap((void*) reader->ring, sizeof(ExportRing));
+    reader->ring = nullptr;
+}
+
+// Number of frames the emulator has published; the newest is this minus one.
+uint64_t shmreader_published(const ShmReader* reader) {
+    return reader->ring->published.load(std::memory_order_acquire);
+}
+
+// Returns the slot frame lives in, or nullptr if the writer is in it.
+const ExportFrame* shmreader_begin(const ShmReader* reader, uint64_t frame, uint32_t* seq) {
+    const ExportFrame* slot = &reader->ring->frames[frame & (SHM_EXPORT_SLOTS - 1)];
+    *seq = slot->seq.load(std::memory_order_acquire);
+    return *seq & 1 ? nullptr : slot;
+}
+
+// True if nothing was written to the slot since begin and it holds frame.
+bool shmreader_end(const ExportFrame* slot, uint64_t frame, uint32_t seq) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot->seq.load(std::memory_order_relaxed) == seq && slot->frame == frame;
+}
+
+// Copies one frame out, retrying while the emulator is writing to it.
+int shmreader_read(const ShmReader* reader, uint64_t frame, ExportFrame* out) {
+    while (true) {
+        uint64_t published = shmreader_published(reader);
+        if (frame >= published)
+            return SHM_READ_PENDING;
+        if (published - frame > SHM_EXPORT_SLOTS)
+            return SHM_READ_OVERWRITTEN;
+
+        uint32_t seq;
+        const ExportFrame* slot = shmreader_begin(reader, frame, &seq);
+        if (!slot)
+            continue;
+        out->frame = slot->frame;
+        out->PC = slot->PC;
+        out->I = slot->I;
+        out->SP = slot->SP;
+        out->DT = slot->DT;
+        out->ST = slot->ST;
+        memcpy(out->V, slot->V, sizeof(out->V));
+        memcpy(out->stack, slot->stack, sizeof(out->stack));
+        memcpy(out->screen, slot->screen, SCREEN_SIZE);
+        if (shmreader_end(slot, frame, seq)) {
+            out->seq.store(seq, std::memory_order_relaxed);
+            return SHM_READ_OK;
+        }
+        if (slot->frame > frame)
+            return SHM_READ_OVERWRITTEN;
+    }
+}
+
+// Copies the newest published frame. Returns SHM_READ_PENDING if there is none.
+int shmreader_latest(const ShmReader* reader, ExportFrame* out) {
+    while (true) {
+        uint64_t published = shmreader_published(reader);
+        if (published == 0)
+            return SHM_READ_PENDING;
+        int res = shmreader_read(reader, published - 1, out);
+        if (res != SHM_READ_OVERWRITTEN)
+            return res;
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef CHIP8EMULATOR_SHMREAD_H
+#define CHIP8EMULATOR_SHMREAD_H
+
+#include "shmexport.h"
+
+// shmreader_read() results
+#define SHM_READ_OK 0
+#define SHM_READ_PENDING 1     // not published yet
+#define SHM_READ_OVERWRITTEN 2 // the ring has moved past it
+
+/*
+ * Reader side of the export ring, for external consumers. The mapping is
+ * read-only, so readers cannot disturb the emulator or each other.
+ *
+ * For zero-copy use, read a frame in place between shmreader_begin() and
+ * shmreader_end(); anything read is only valid if end returns true.
+ */
+typedef struct {
+    const ExportRing* ring;
+} ShmReader;
+
+int shmreader_open(ShmReader* reader, const char* name);
+
+void shmreader_close(ShmReader* reader);
+
+uint64_t shmreader_published(const ShmReader* reader);
+
+const ExportFrame* shmreader_begin(const ShmReader* reader, uint64_t frame, uint32_t* seq);
+
+bool shmreader_end(const ExportFrame* slot, uint64_t frame, uint32_t seq);
+
+int shmreader_read(const ShmReader* reader, uint64_t frame, ExportFrame* out);
+
+int shmreader_latest(const ShmReader* reader, ExportFrame* out);
+
+#endif //CHIP8EMULATOR_SHMREAD_H
@@ -0,0 +1,28 @@
+#ifndef CHIP8EMULATOR_SIMD_H
+#define CHIP8EMULATOR_SIMD_H
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHIP8_X86 1
+#endif
+
+typedef enum {
+    SIMD_NONE,
+    SIMD_SSE2,
+    SIMD_AVX2,
+} SimdLevel;
+
+// Best instruction set the running CPU supports. Kernels are compiled for
+// all of them and picked at runtime, so one binary serves every host.
+inline SimdLevel detect_simd() {
+#ifdef CHIP8_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return SIMD_SSE2;
+#endif
+    return SIMD_NONE;
+}
+
+#endif //CHIP8EMULATOR_SIMD_H
@@ -0,0 +1,51 @@
+#include "trace.h"
+
+int trace_write(const char* path, Chip8* chip8, int fault) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return 1;
+
+    uint32_t total = chip8->trace_count();
+    uint32_t count = total < TRACE_SIZE ? total : TRACE_SIZE;
+
+    TraceHeader header = {};
+    memcpy(header.magic, TRACE_MAGIC, 4);
+    header.version = TRACE_VERSION;
+    header.fault = fault;
+    header.count = count;
+    chip8->save_state(&header.state);
+    file.write((const char*) &header, sizeof(header));
+
+    // unroll the ring so the file reads oldest to newest
+    const TraceRecord* trace = chip8->trace_dump();
+    for (uint32_t i = total - count; i != total; i++)
+        file.write((const char*) &trace[i & (TRACE_SIZE - 1)], sizeof(TraceRecord));
+
+    return file.good() ? 0 : 1;
+}
+
+int trace_read(const char* path, TraceHeader* header, std::vector<TraceRecord>* records) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return 1;
+
+    file.read((char*) header, sizeof(*header));
+    if (!file || memcmp(header->magic, TRACE_MAGIC, 4) != 0 || header->version != TRACE_VERSION)
+        return 1;
+    if (header->count > TRACE_SIZE)
+        return 1;
+
+    records->resize(header->count);
+    file.read((char*) records->data(), header->count * sizeof(TraceRecord));
+    return file ? 0 : 1;
+}
+
+const char* fault_name(int fault) {
+    switch (fault) {
+        case 0: return "none";
+        case ERR_UNKNOWN_OPCODE: return "unknown opcode";
+        case ERR_STACK_OVERFLOW: return "stack overflow";
+        case ERR_STACK_UNDERFLOW: return "stack underflow";
+        default: return "unknown fault";
+    }
+}
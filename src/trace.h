@@ -0,0 +1,24 @@
+#ifndef CHIP8EMULATOR_TRACE_H
+#define CHIP8EMULATOR_TRACE_H
+
+#include "chip8.h"
+
+#define TRACE_MAGIC "C8TR"
+#define TRACE_VERSION 1
+#define TRACE_FILE "chip8_fault.trace"
+
+// Post-mortem dump: this header, then `count` TraceRecords, oldest first.
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    int32_t fault;  // cycle() result that triggered the dump
+    uint32_t count;
+    Chip8State state;
+} TraceHeader;
+
+int trace_write(const char* path, Chip8* chip8, int fault);
+int trace_read(const char* path, TraceHeader* header, std::vector<TraceRecord>* records);
+
+const char* fault_name(int fault);
+
+#endif //CHIP8EMULATOR_TRACE_H
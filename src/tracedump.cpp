@@ -0,0 +1,54 @@
+#include "debugger.h"
+#include "trace.h"
+
+// Whether the instruction leaves a new value in VX worth annotating.
+static bool writes_vx(uint16_t opcode) {
+    switch (opcode & 0xF000) {
+        case 0x6000:
+        case 0x7000:
+        case 0x8000:
+        case 0xC000:
+            return true;
+        case 0xF000:
+            return (opcode & 0xFF) == 0x07 || (opcode & 0xFF) == 0x0A || (opcode & 0xFF) == 0x65;
+        default:
+            return false;
+    }
+}
+
+// Renders a post-mortem trace written by trace_write() as annotated
+// disassembly followed by the machine state at the time of the fault.
+int main(int argc, char* argv[]) {
+    const char* path = argc > 1 ? argv[1] : TRACE_FILE;
+    TraceHeader header;
+    std::vector<TraceRecord> records;
+
+    if (trace_read(path, &header, &records)) {
+        fprintf(stderr, "Error: %s is not a readable trace file\n", path);
+        return 1;
+    }
+
+    printf("fault: %s (%d)\n", fault_name(header.fault), header.fault);
+    printf("last %u instructions:\n", header.count);
+
+    char text[32];
+    for (size_t i = 0; i < records.size(); i++) {
+        const TraceRecord* rec = &records[i];
+        bool faulted = header.fault != 0 && i + 1 == records.size();
+        disassemble(rec->opcode, text, sizeof(text));
+        printf("%s 0x%03X: %04X  %-16s ;", faulted ? ">>" : "  ", rec->PC, rec->opcode, text);
+        if (writes_vx(rec->opcode))
+            printf(" V%X=0x%02X", rec->reg, rec->value);
+        printf(" I=0x%03X\n", rec->I);
+    }
+
+    const Chip8State* s = &header.state;
+    printf("\nPC=0x%03X I=0x%03X SP=%u DT=%u ST=%u\n", s->PC, s->I, s->SP, s->DT, s->ST);
+    for (int i = 0; i < 16; i++)
+        printf("V%X=0x%02X%s", i, s->V[i], i % 8 == 7 ? "\n" : " ");
+    printf("stack:");
+    for (int i = 1; i <= s->SP && i < 16; i++)
+        printf(" 0x%03X", s->stack[i]);
+    printf("\n");
+    return 0;
+}
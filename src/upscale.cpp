@@ -0,0 +1,392 @@
+#include "upscale.h"
+
+#define PAD 16
+#define PAD_WIDTH (SCREEN_WIDTH + 2 * PAD)
+
+static int filter_factor(UpscaleFilter filter) {
+    switch (filter) {
+        case FILTER_SCALE2X: return 2;
+        case FILTER_SCALE3X: return 3;
+        default: return 1;
+    }
+}
+
+int upscaler_create(Upscaler* up, int out_width, int out_height, UpscaleFilter filter, uint8_t decay) {
+    memset(up->intensity, 0, SCREEN_SIZE);
+    up->decay = decay;
+    up->filter = filter;
+    up->simd = detect_simd();
+    up->out_width = out_width;
+    up->out_height = out_height;
+
+    int factor = filter_factor(filter);
+    up->scaled_width = SCREEN_WIDTH * factor;
+    up->scaled_height = SCREEN_HEIGHT * factor;
+
+    up->scaled = (uint8_t*) calloc(up->scaled_width * up->scaled_height, 1);
+    up->row = (uint8_t*) calloc(out_width + 32, 1);
+    up->xmap = (uint16_t*) calloc(out_width, sizeof(uint16_t));
+    if (!up->scaled || !up->row || !up->xmap) {
+        upscaler_destroy(up);
+        return 1;
+    }
+
+    for (int x = 0; x < out_width; x++)
+        up->xmap[x] = x * up->scaled_width / out_width;
+    return 0;
+}
+
+void upscaler_destroy(Upscaler* up) {
+    free(up->scaled);
+    free(up->row);
+    free(up->xmap);
+    up->scaled = nullptr;
+    up->row = nullptr;
+    up->xmap = nullptr;
+}
+
+/*
+ * Phosphor blend: intensity = max(lit ? 255 : 0, intensity * decay / 256)
+ */
+
+static void blend_scalar(uint8_t* intensity, const uint8_t* screen, uint8_t decay) {
+    for (int i = 0; i < SCREEN_SIZE; i++) {
+        uint8_t faded = (intensity[i] * decay) >> 8;
+        intensity[i] = screen[i] ? 0xFF : faded;
+    }
+}
+
+#ifdef CHIP8_X86
+static void blend_sse2(uint8_t* intensity, const uint8_t* screen, uint8_t decay) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i d = _mm_set1_epi16(decay);
+    for (int i = 0; i < SCREEN_SIZE; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*) &intensity[i]);
+        __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), d), 8);
+        __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), d), 8);
+        __m128i faded = _mm_packus_epi16(lo, hi);
+        __m128i lit = _mm_cmpgt_epi8(_mm_loadu_si128((const __m128i*) &screen[i]), zero);
+        _mm_storeu_si128((__m128i*) &intensity[i], _mm_or_si128(faded, lit));
+    }
+}
+
+__attribute__((target("avx2")))
+static void blend_avx2(uint8_t* intensity, const uint8_t* screen, uint8_t decay) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i d = _mm256_set1_epi16(decay);
+    for (int i = 0; i < SCREEN_SIZE; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*) &intensity[i]);
+        // unpack/pack both work within 128 bit lanes, so element order is kept
+        __m256i lo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(v, zero), d), 8);
+        __m256i hi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(v, zero), d), 8);
+        __m256i faded = _mm256_packus_epi16(lo, hi);
+        __m256i lit = _mm256_cmpgt_epi8(_mm256_loadu_si256((const __m256i*) &screen[i]), zero);
+        _mm256_storeu_si256((__m256i*) &intensity[i], _mm256_or_si256(faded, lit));
+    }
+}
+#endif
+
+void upscaler_blend(Upscaler* up, const uint8_t* screen) {
+#ifdef CHIP8_X86
+    if (up->simd == SIMD_AVX2) return blend_avx2(up->intensity, screen, up->decay);
+    if (up->simd == SIMD_SSE2) return blend_sse2(up->intensity, screen, up->decay);
+#endif
+    blend_scalar(up->intensity, screen, up->decay);
+}
+
+/*
+ * Scale2x/Scale3x (AdvMAME) over the intensity buffer. Neighbours come from
+ * a copy padded on every side with the edge pixels, so the kernels need no
+ * bounds checks:
+ *   A B C
+ *   D E F
+ *   G H I
+ */
+
+static void pad_source(const uint8_t* src, uint8_t pad[SCREEN_HEIGHT + 2][PAD_WIDTH]) {
+    for (int y = -1; y <= SCREEN_HEIGHT; y++) {
+        int sy = y < 0 ? 0 : (y == SCREEN_HEIGHT ? SCREEN_HEIGHT - 1 : y);
+        uint8_t* row = &pad[y + 1][PAD];
+        memcpy(row, &src[sy * SCREEN_WIDTH], SCREEN_WIDTH);
+        row[-1] = row[0];
+        row[SCREEN_WIDTH] = row[SCREEN_WIDTH - 1];
+    }
+}
+
+static void scale2x_scalar(uint8_t pad[SCREEN_HEIGHT + 2][PAD_WIDTH], uint8_t* dst) {
+    int dw = SCREEN_WIDTH * 2;
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        const uint8_t* above = &pad[y][PAD];
+        const uint8_t* mid = &pad[y + 1][PAD];
+        const uint8_t* below = &pad[y + 2][PAD];
+        uint8_t* out0 = &dst[(2 * y) * dw];
+        uint8_t* out1 = out0 + dw;
+
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            uint8_t B = above[x], D = mid[x - 1], E = mid[x], F = mid[x + 1], H = below[x];
+            out0[2 * x]     = D == B && B != F && D != H ? D : E;
+            out0[2 * x + 1] = B == F && B != D && F != H ? F : E;
+            out1[2 * x]     = D == H && D != B && H != F ? D : E;
+            out1[2 * x + 1] = H == F && D != H && B != F ? F : E;
+        }
+    }
+}
+
+static void scale3x_scalar(uint8_t pad[SCREEN_HEIGHT + 2][PAD_WIDTH], uint8_t* dst) {
+    int dw = SCREEN_WIDTH * 3;
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        const uint8_t* above = &pad[y][PAD];
+        const uint8_t* mid = &pad[y + 1][PAD];
+        const uint8_t* below = &pad[y + 2][PAD];
+        uint8_t* out0 = &dst[(3 * y) * dw];
+        uint8_t* out1 = out0 + dw;
+        uint8_t* out2 = out1 + dw;
+
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            uint8_t A = above[x - 1], B = above[x], C = above[x + 1];
+            uint8_t D = mid[x - 1], E = mid[x], F = mid[x + 1];
+            uint8_t G = below[x - 1], H = below[x], I = below[x + 1];
+            bool db = D == B && B != F && D != H;
+            bool bf = B == F && B != D && F != H;
+            bool dh = D == H && D != B && H != F;
+            bool hf = H == F && D != H && B != F;
+
+            out0[3 * x]     = db ? D : E;
+            out0[3 * x + 1] = (db && E != C) || (bf && E != A) ? B : E;
+            out0[3 * x + 2] = bf ? F : E;
+            out1[3 * x]     = (db && E != G) || (dh && E != A) ? D : E;
+            out1[3 * x + 1] = E;
+            out1[3 * x + 2] = (bf && E != I) || (hf && E != C) ? F : E;
+            out2[3 * x]     = dh ? D : E;
+            out2[3 * x + 1] = (dh && E != I) || (hf && E != G) ? H : E;
+            out2[3 * x + 2] = hf ? F : E;
+        }
+    }
+}
+
+#ifdef CHIP8_X86
+#define SEL(m, a, b) _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b))
+#define EQ(a, b) _mm_cmpeq_epi8(a, b)
+#define NE(a, b) _mm_xor_si128(_mm_cmpeq_epi8(a, b), ones)
+#define AND3(a, b, c) _mm_and_si128(_mm_and_si128(a, b), c)
+
+static void scale2x_sse2(uint8_t pad[SCREEN_HEIGHT + 2][PAD_WIDTH], uint8_t* dst) {
+    const __m128i ones = _mm_set1_epi8(-1);
+    int dw = SCREEN_WIDTH * 2;
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        const uint8_t* above = &pad[y][PAD];
+        const uint8_t* mid = &pad[y + 1][PAD];
+        const uint8_t* below = &pad[y + 2][PAD];
+        uint8_t* out0 = &dst[(2 * y) * dw];
+        uint8_t* out1 = out0 + dw;
+
+        for (int x = 0; x < SCREEN_WIDTH; x += 16) {
+            __m128i B = _mm_loadu_si128((const __m128i*) &above[x]);
+            __m128i D = _mm_loadu_si128((const __m128i*) &mid[x - 1]);
+            __m128i E = _mm_loadu_si128((const __m128i*) &mid[x]);
+            __m128i F = _mm_loadu_si128((const __m128i*) &mid[x + 1]);
+            __m128i H = _mm_loadu_si128((const __m128i*) &below[x]);
+
+            __m128i E0 = SEL(AND3(EQ(D, B), NE(B, F), NE(D, H)), D, E);
+            __m128i E1 = SEL(AND3(EQ(B, F), NE(B, D), NE(F, H)), F, E);
+            __m128i E2 = SEL(AND3(EQ(D, H), NE(D, B), NE(H, F)), D, E);
+            __m128i E3 = SEL(AND3(EQ(H, F), NE(D, H), NE(B, F)), F, E);
+
+            _mm_storeu_si128((__m128i*) &out0[2 * x], _mm_unpacklo_epi8(E0, E1));
+            _mm_storeu_si128((__m128i*) &out0[2 * x + 16], _mm_unpackhi_epi8(E0, E1));
+            _mm_storeu_si128((__m128i*) &out1[2 * x], _mm_unpacklo_epi8(E2, E3));
+            _mm_storeu_si128((__m128i*) &out1[2 * x + 16], _mm_unpackhi_epi8(E2, E3));
+        }
+    }
+}
+
+// SSE2 has no cheap 3-way byte interleave, so the nine sub-pixel planes are
+// selected with vector compares and woven together with scalar stores.
+static void scale3x_sse2(uint8_t pad[SCREEN_HEIGHT + 2][PAD_WIDTH], uint8_t* dst) {
+    const __m128i ones = _mm_set1_epi8(-1);
+    alignas(16) uint8_t planes[9][16];
+    int dw = SCREEN_WIDTH * 3;
+
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        const uint8_t* above = &pad[y][PAD];
+        const uint8_t* mid = &pad[y + 1][PAD];
+        const uint8_t* below = &pad[y + 2][PAD];
+        uint8_t* out0 = &dst[(3 * y) * dw];
+        uint8_t* out1 = out0 + dw;
+        uint8_t* out2 = out1 + dw;
+
+        for (int x = 0; x < SCREEN_WIDTH; x += 16) {
+            __m128i A = _mm_loadu_si128((const __m128i*) &above[x - 1]);
+            __m128i B = _mm_loadu_si128((const __m128i*) &above[x]);
+            __m128i C = _mm_loadu_si128((const __m128i*) &above[x + 1]);
+            __m128i D = _mm_loadu_si128((const __m128i*) &mid[x - 1]);
+            __m128i E = _mm_loadu_si128((const __m128i*) &mid[x]);
+            __m128i F = _mm_loadu_si128((const __m128i*) &mid[x + 1]);
+            __m128i G = _mm_loadu_si128((const __m128i*) &below[x - 1]);
+            __m128i H = _mm_loadu_si128((const __m128i*) &below[x]);
+            __m128i I = _mm_loadu_si128((const __m128i*) &below[x + 1]);
+
+            __m128i db = AND3(EQ(D, B), NE(B, F), NE(D, H));
+            __m128i bf = AND3(EQ(B, F), NE(B, D), NE(F, H));
+            __m128i dh = AND3(EQ(D, H), NE(D, B), NE(H, F));
+            __m128i hf = AND3(EQ(H, F), NE(D, H), NE(B, F));
+
+            __m128i m1 = _mm_or_si128(_mm_and_si128(db, NE(E, C)), _mm_and_si128(bf, NE(E, A)));
+            __m128i m3 = _mm_or_si128(_mm_and_si128(db, NE(E, G)), _mm_and_si128(dh, NE(E, A)));
+            __m128i m5 = _mm_or_si128(_mm_and_si128(bf, NE(E, I)), _mm_and_si128(hf, NE(E, C)));
+            __m128i m7 = _mm_or_si128(_mm_and_si128(dh, NE(E, I)), _mm_and_si128(hf, NE(E, G)));
+
+            _mm_store_si128((__m128i*) planes[0], SEL(db, D, E));
+            _mm_store_si128((__m128i*) planes[1], SEL(m1, B, E));
+            _mm_store_si128((__m128i*) planes[2], SEL(bf, F, E));
+            _mm_store_si128((__m128i*) planes[3], SEL(m3, D, E));
+            _mm_store_si128((__m128i*) planes[4], E);
+            _mm_store_si128((__m128i*) planes[5], SEL(m5, F, E));
+            _mm_store_si128((__m128i*) planes[6], SEL(dh, D, E));
+            _mm_store_si128((__m128i*) planes[7], SEL(m7, H, E));
+            _mm_store_si128((__m128i*) planes[8], SEL(hf, F, E));
+
+            for (int i = 0; i < 16; i++) {
+                uint8_t* o0 = &out0[3 * (x + i)];
+                uint8_t* o1 = &out1[3 * (x + i)];
+                uint8_t* o2 = &out2[3 * (x + i)];
+                o0[0] = planes[0][i]; o0[1] = planes[1][i]; o0[2] = planes[2][i];
+                o1[0] = planes[3][i]; o1[1] = planes[4][i]; o1[2] = planes[5][i];
+                o2[0] = planes[6][i]; o2[1] = planes[7][i]; o2[2] = planes[8][i];
+            }
+        }
+    }
+}
+
+#undef SEL
+#undef EQ
+#undef NE
+#undef AND3
+#endif
+
+/*
+ * Grey intensity row -> ARGB8888 (B, G, R, A = i, i, i, 0xFF in memory).
+ */
+
+static void expand_scalar(const uint8_t* row, uint32_t* out, int width) {
+    for (int x = 0; x < width; x++)
+        out[x] = 0xFF000000 | (row[x] * 0x010101u);
+}
+
+#ifdef CHIP8_X86
+static void expand_sse2(const uint8_t* row, uint32_t* out, int width) {
+    const __m128i alpha = _mm_set1_epi8(-1);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*) &row[x]);
+        __m128i vv_lo = _mm_unpacklo_epi8(v, v);
+        __m128i vv_hi = _mm_unpackhi_epi8(v, v);
+        __m128i va_lo = _mm_unpacklo_epi8(v, alpha);
+        __m128i va_hi = _mm_unpackhi_epi8(v, alpha);
+        _mm_storeu_si128((__m128i*) &out[x], _mm_unpacklo_epi16(vv_lo, va_lo));
+        _mm_storeu_si128((__m128i*) &out[x + 4], _mm_unpackhi_epi16(vv_lo, va_lo));
+        _mm_storeu_si128((__m128i*) &out[x + 8], _mm_unpacklo_epi16(vv_hi, va_hi));
+        _mm_storeu_si128((__m128i*) &out[x + 12], _mm_unpackhi_epi16(vv_hi, va_hi));
+    }
+    expand_scalar(&row[x], &out[x], width - x);
+}
+
+__attribute__((target("avx2")))
+static void expand_avx2(const uint8_t* row, uint32_t* out, int width) {
+    const __m256i alpha = _mm256_set1_epi8(-1);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        // qword shuffle so the in-lane unpacks yield pixels 0-15 then 16-31
+        __m256i v = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i*) &row[x]), 0xD8);
+        __m256i vv_lo = _mm256_unpacklo_epi8(v, v);
+        __m256i vv_hi = _mm256_unpackhi_epi8(v, v);
+        __m256i va_lo = _mm256_unpacklo_epi8(v, alpha);
+        __m256i va_hi = _mm256_unpackhi_epi8(v, alpha);
+        __m256i p0 = _mm256_unpacklo_epi16(vv_lo, va_lo);
+        __m256i p1 = _mm256_unpackhi_epi16(vv_lo, va_lo);
+        __m256i p2 = _mm256_unpacklo_epi16(vv_hi, va_hi);
+        __m256i p3 = _mm256_unpackhi_epi16(vv_hi, va_hi);
+        _mm256_storeu_si256((__m256i*) &out[x], _mm256_permute2x128_si256(p0, p1, 0x20));
+        _mm256_storeu_si256((__m256i*) &out[x + 8], _mm256_permute2x128_si256(p0, p1, 0x31));
+        _mm256_storeu_si256((__m256i*) &out[x + 16], _mm256_permute2x128_si256(p2, p3, 0x20));
+        _mm256_storeu_si256((__m256i*) &out[x + 24], _mm256_permute2x128_si256(p2, p3, 0x31));
+    }
+    expand_sse2(&row[x], &out[x], width - x);
+}
+#endif
+
+// Duplicates an output row. The texture is write-only from here on, so on x86
+// non-temporal stores skip pulling its cache lines in first.
+static void copy_row(uint32_t* out, const uint32_t* prev, int width, SimdLevel simd) {
+#ifdef CHIP8_X86
+    if (simd != SIMD_NONE && ((uintptr_t) out & 15) == 0 && ((uintptr_t) prev & 15) == 0) {
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m128i a = _mm_load_si128((const __m128i*) &prev[x]);
+            __m128i b = _mm_load_si128((const __m128i*) &prev[x + 4]);
+            __m128i c = _mm_load_si128((const __m128i*) &prev[x + 8]);
+            __m128i d = _mm_load_si128((const __m128i*) &prev[x + 12]);
+            _mm_stream_si128((__m128i*) &out[x], a);
+            _mm_stream_si128((__m128i*) &out[x + 4], b);
+            _mm_stream_si128((__m128i*) &out[x + 8], c);
+            _mm_stream_si128((__m128i*) &out[x + 12], d);
+        }
+        memcpy(&out[x], &prev[x], (width - x) * sizeof(uint32_t));
+        return;
+    }
+#endif
+    memcpy(out, prev, width * sizeof(uint32_t));
+}
+
+// Filters the intensity buffer and writes out_width x out_height ARGB8888
+// pixels. pitch is in bytes, as for SDL_LockTexture.
+void upscaler_render(Upscaler* up, uint32_t* pixels, int pitch) {
+    const uint8_t* src = up->intensity;
+
+    if (up->filter != FILTER_NEAREST) {
+        uint8_t pad[SCREEN_HEIGHT + 2][PAD_WIDTH];
+        pad_source(up->intensity, pad);
+#ifdef CHIP8_X86
+        if (up->simd != SIMD_NONE) {
+            if (up->filter == FILTER_SCALE2X) scale2x_sse2(pad, up->scaled);
+            else scale3x_sse2(pad, up->scaled);
+        } else
+#endif
+        {
+            if (up->filter == FILTER_SCALE2X) scale2x_scalar(pad, up->scaled);
+            else scale3x_scalar(pad, up->scaled);
+        }
+        src = up->scaled;
+    }
+
+    int prev_sy = -1;
+    uint32_t* prev_out = nullptr;
+    for (int y = 0; y < up->out_height; y++) {
+        auto* out = (uint32_t*) ((uint8_t*) pixels + (size_t) y * pitch);
+        int sy = y * up->scaled_height / up->out_height;
+
+        // most output rows repeat the one above; copying beats re-expanding
+        if (sy == prev_sy) {
+            copy_row(out, prev_out, up->out_width, up->simd);
+            continue;
+        }
+
+        const uint8_t* srow = &src[sy * up->scaled_width];
+        for (int x = 0; x < up->out_width; x++)
+            up->row[x] = srow[up->xmap[x]];
+
+#ifdef CHIP8_X86
+        if (up->simd == SIMD_AVX2) expand_avx2(up->row, out, up->out_width);
+        else if (up->simd == SIMD_SSE2) expand_sse2(up->row, out, up->out_width);
+        else
+#endif
+        expand_scalar(up->row, out, up->out_width);
+
+        prev_sy = sy;
+        prev_out = out;
+    }
+#ifdef CHIP8_X86
+    if (up->simd != SIMD_NONE)
+        _mm_sfence();
+#endif
+}
@@ -0,0 +1,46 @@
+#ifndef CHIP8EMULATOR_UPSCALE_H
+#define CHIP8EMULATOR_UPSCALE_H
+
+#include "chip8.h"
+#include "simd.h"
+
+#define PHOSPHOR_DECAY 0xA0 // intensity kept per frame, out of 256
+
+typedef enum {
+    FILTER_NEAREST,
+    FILTER_SCALE2X,
+    FILTER_SCALE3X,
+} UpscaleFilter;
+
+/*
+ * CPU post-processing for the 64x32 framebuffer. Each frame is blended into
+ * a per-pixel intensity buffer that decays over time, so sprites that are
+ * XOR-erased and redrawn between frames stay lit instead of flickering. The
+ * intensities then go through the selected filter and are expanded to
+ * ARGB8888 at the output size with nearest-neighbour sampling.
+ */
+typedef struct {
+    uint8_t intensity[SCREEN_SIZE];
+    uint8_t decay;
+    UpscaleFilter filter;
+    SimdLevel simd;
+
+    int out_width;
+    int out_height;
+
+    int scaled_width;
+    int scaled_height;
+    uint8_t* scaled;  // filter output, scaled_width * scaled_height
+    uint8_t* row;     // one output row of intensities
+    uint16_t* xmap;   // output column -> scaled column
+} Upscaler;
+
+int upscaler_create(Upscaler* up, int out_width, int out_height, UpscaleFilter filter, uint8_t decay);
+
+void upscaler_destroy(Upscaler* up);
+
+void upscaler_blend(Upscaler* up, const uint8_t* screen);
+
+void upscaler_render(Upscaler* up, uint32_t* pixels, int pitch);
+
+#endif //CHIP8EMULATOR_UPSCALE_H
@@ -1,38 +1,53 @@
 #include "window.h"
 
-int gfx_create(GfxContext* ctx) {
-    if (SDL_Init(SDL_INIT_EVERYTHING))
+// Only prepares the upscaler; the window is opened by the first gfx_update
+// so the emulator starts running without waiting on SDL.
+int gfx_create(GfxContext* ctx, UpscaleFilter filter, uint8_t decay) {
+    ctx->window = nullptr;
+    ctx->renderer = nullptr;
+    ctx->texture = nullptr;
+    return upscaler_create(&ctx->upscaler, WINDOW_WIDTH, WINDOW_HEIGHT, filter, decay);
+}
+
+// Brings up the two SDL subsystems we use, then the window and texture.
+static int gfx_open(GfxContext* ctx) {
+    if (SDL_InitSubSystem(SDL_INIT_VIDEO | SDL_INIT_EVENTS))
         return 1;
 
     ctx->window = SDL_CreateWindow("CHIP-8", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-                                   SCREEN_WIDTH*SCREEN_SCALE_FACTOR, SCREEN_HEIGHT*SCREEN_SCALE_FACTOR,
-                                   SDL_WINDOW_SHOWN);
-    if (!ctx->window) {
-        gfx_destroy(ctx);
+                                   WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_SHOWN);
+    if (!ctx->window)
         return 1;
-    }
 
     ctx->renderer = SDL_CreateRenderer(ctx->window, -1, SDL_RENDERER_ACCELERATED);
-    if (!ctx->renderer) {
-        gfx_destroy(ctx);
+    if (!ctx->renderer)
         return 1;
-    }
-    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, 0);
-    SDL_RenderSetLogicalSize(ctx->renderer, SCREEN_WIDTH, SCREEN_HEIGHT);
 
+    // the upscaler fills the texture at window resolution, so no GPU scaling
+    ctx->texture = SDL_CreateTexture(ctx->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                     WINDOW_WIDTH, WINDOW_HEIGHT);
+    if (!ctx->texture)
+        return 1;
 
     return 0;
 }
 
+// Called once per frame, whether or not the screen changed, so that the
+// phosphor keeps decaying.
 int gfx_update(GfxContext* ctx, const uint8_t* pixels) {
-    SDL_SetRenderDrawColor(ctx->renderer, 0x0, 0x0, 0x0, 0x0);
-    SDL_RenderClear(ctx->renderer);
-    SDL_SetRenderDrawColor(ctx->renderer, 0xFF, 0xFF, 0xFF, 0xFF);
-    for (int y = 0; y < SCREEN_HEIGHT; y++) {
-        for (int x = 0; x < SCREEN_WIDTH; x++) {
-            if (pixels[y*SCREEN_WIDTH + x]) SDL_RenderDrawPoint(ctx->renderer, x, y);
-        }
-    }
+    void* texels;
+    int pitch;
+
+    if (!ctx->texture && gfx_open(ctx))
+        return 1;
+
+    upscaler_blend(&ctx->upscaler, pixels);
+    if (SDL_LockTexture(ctx->texture, nullptr, &texels, &pitch))
+        return 1;
+    upscaler_render(&ctx->upscaler, (uint32_t*) texels, pitch);
+    SDL_UnlockTexture(ctx->texture);
+
+    SDL_RenderCopy(ctx->renderer, ctx->texture, nullptr, nullptr);
     SDL_RenderPresent(ctx->renderer);
     return 0;
 }
@@ -50,6 +65,7 @@ void gfx_destroy(GfxContext* ctx) {
         SDL_DestroyWindow(ctx->window);
         ctx->window = nullptr;
     }
+    upscaler_destroy(&ctx->upscaler);
     SDL_Quit();
 }
 
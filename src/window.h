@@ -7,11 +7,16 @@
 
 #include "SDL.h"
 #include "chip8.h"
+#include "upscale.h"
+
+#define WINDOW_WIDTH (SCREEN_WIDTH * SCREEN_SCALE_FACTOR)
+#define WINDOW_HEIGHT (SCREEN_HEIGHT * SCREEN_SCALE_FACTOR)
 
 typedef struct {
     SDL_Window *window;
     SDL_Renderer *renderer;
     SDL_Texture *texture;
+    Upscaler upscaler;
 } GfxContext;
 
 const char keys[] = {SDL_SCANCODE_X, SDL_SCANCODE_1, SDL_SCANCODE_2, SDL_SCANCODE_3,
@@ -19,7 +24,7 @@ const char keys[] = {SDL_SCANCODE_X, SDL_SCANCODE_1, SDL_SCANCODE_2, SDL_SCANCOD
                      SDL_SCANCODE_S, SDL_SCANCODE_D, SDL_SCANCODE_Z, SDL_SCANCODE_C,
                      SDL_SCANCODE_4, SDL_SCANCODE_R, SDL_SCANCODE_F, SDL_SCANCODE_V};
 
-int gfx_create(GfxContext* ctx);
+int gfx_create(GfxContext* ctx, UpscaleFilter filter, uint8_t decay);
 
 int gfx_update(GfxContext* ctx, const uint8_t* pixels);
 
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include "bench.h"
+
+static std::string run_bench(Chip8* chip8, BenchConfig* cfg, int* res) {
+    FILE* out = tmpfile();
+    *res = bench_run(chip8, cfg, out);
+    rewind(out);
+    char buff[1024] = {};
+    fread(buff, 1, sizeof(buff) - 1, out);
+    fclose(out);
+    return buff;
+}
+
+TEST(Bench, Report) {
+    unsigned char rom[] = {0x60, 0x01, 0x70, 0x01, 0x12, 0x02}; // LD V0, 1; ADD V0, 1; JP 0x202
+    Chip8 chip8(LOOP_FREQ, P_CHIP8, 1);
+    chip8.set_IPF(4);
+    chip8.load_rom(rom, sizeof(rom));
+
+    BenchConfig cfg = {"loop.ch8", 10, "chip8", 1, {}};
+    int res;
+    std::string report = run_bench(&chip8, &cfg, &res);
+    ASSERT_EQ(res, 0);
+    EXPECT_NE(report.find("\"rom\":\"loop.ch8\""), std::string::npos);
+    EXPECT_NE(report.find("\"frames\":10,"), std::string::npos);
+    EXPECT_NE(report.find("\"instructions\":40,"), std::string::npos);
+    EXPECT_NE(report.find("\"6\":1,"), std::string::npos);
+    EXPECT_NE(report.find("\"fault\":0}"), std::string::npos);
+}
+
+TEST(Bench, Fault) {
+    unsigned char rom[] = {0x00, 0xEE}; // RET with an empty stack
+    Chip8 chip8(LOOP_FREQ, P_CHIP8, 1);
+    chip8.load_rom(rom, sizeof(rom));
+
+    BenchConfig cfg = {"ret.ch8", 10, "chip8", 1, {}};
+    int res;
+    std::string report = run_bench(&chip8, &cfg, &res);
+    ASSERT_EQ(res, ERR_STACK_UNDERFLOW);
+    EXPECT_NE(report.find("\"frames\":1,"), std::string::npos);
+}
+
+TEST(Bench, InputScript) {
+    const char* path = "bench_test_input.txt";
+    std::ofstream(path) << "# frame key action\n5 a up\n2 A down\n";
+
+    std::vector<InputEvent> events;
+    ASSERT_EQ(load_input_script(path, &events), 0);
+    ASSERT_EQ(events.size(), 2);
+    EXPECT_EQ(events[0].frame, 2);
+    EXPECT_EQ(events[0].key, 0xA);
+    EXPECT_TRUE(events[0].down);
+    EXPECT_FALSE(events[1].down);
+    remove(path);
+}
@@ -1,10 +1,15 @@
 #include <gtest/gtest.h>
 #include "chip8.h"
+#include "romgen.h"
+#include "trace.h"
 
 class Chip8Test : public testing::Test {
 protected:
     Chip8* chip8a = (Chip8*) new Chip8(LOOP_FREQ, P_CHIP8, time(nullptr));
 
+    void TearDown() override {
+        delete chip8a;
+    }
 };
 
 TEST_F(Chip8Test, InitZero) {
@@ -22,6 +27,7 @@ TEST_F(Chip8Test, InitZero) {
         ASSERT_EQ(v_regs[i], 0);
         ASSERT_EQ(stack[i], 0);
     }
+    free(stack);
 }
 
 // 1NNN: Jump
@@ -43,6 +49,7 @@ TEST_F(Chip8Test, ENT_and_RET) {
     stack = chip8a->stack_dump();
     ASSERT_EQ(chip8a->PC_dump(), 0x400);
     ASSERT_EQ(stack[stack[0]+1], 0x200);
+    free(stack);
 
     // 00EE: RET
     chip8a->set_opcode(0x00EE);
@@ -50,6 +57,7 @@ TEST_F(Chip8Test, ENT_and_RET) {
     stack = chip8a->stack_dump();
     ASSERT_EQ(chip8a->PC_dump(), 0x200);
     ASSERT_EQ(stack[0], 0);
+    free(stack);
 }
 
 // 3XNN: Skip if VX == NN
@@ -317,23 +325,230 @@ TEST_F(Chip8Test, SUBF) {
     ASSERT_EQ(V[0xF], 0);
 }
 
+// save_state/load_state round trip
+TEST_F(Chip8Test, STATE) {
+    Chip8State state;
+
+    chip8a->set_opcode(0x6A10);
+    chip8a->decode_and_execute();
+    chip8a->set_opcode(0x2400);
+    chip8a->decode_and_execute();
+    chip8a->save_state(&state);
+
+    Chip8* chip8b = (Chip8*) new Chip8(LOOP_FREQ, P_CHIP8, 0);
+    chip8b->load_state(&state);
+    ASSERT_EQ(chip8b->PC_dump(), 0x400);
+    ASSERT_EQ(chip8b->reg_dump()[0xA], 0x10);
+    ASSERT_EQ(memcmp(chip8b->ram_dump(), chip8a->ram_dump(), RAM_SIZE), 0);
+
+    uint16_t* stack = chip8b->stack_dump();
+    ASSERT_EQ(stack[0], 1);
+    ASSERT_EQ(stack[2], 0x200);
+    free(stack);
+    delete chip8b;
+}
+
+// trace ring and post-mortem dump on stack overflow
+TEST_F(Chip8Test, TRACE) {
+    unsigned char rom[] = {0x60, 0x2A, 0x22, 0x02}; // LD V0, 0x2A; CALL 0x202
+    chip8a->load_rom(rom, sizeof(rom));
+
+    int res = 0;
+    for (int i = 0; i < 100 && res == 0; i++)
+        res = chip8a->cycle();
+    ASSERT_EQ(res, ERR_STACK_OVERFLOW);
+    ASSERT_EQ(chip8a->trace_count(), 17);
+
+    const TraceRecord* rec = &chip8a->trace_dump()[0];
+    ASSERT_EQ(rec->PC, 0x200);
+    ASSERT_EQ(rec->opcode, 0x602A);
+    ASSERT_EQ(rec->value, 0x2A);
+
+    const char* path = "chip8_test.trace";
+    ASSERT_EQ(trace_write(path, chip8a, res), 0);
+
+    TraceHeader header;
+    std::vector<TraceRecord> records;
+    ASSERT_EQ(trace_read(path, &header, &records), 0);
+    ASSERT_EQ(header.fault, ERR_STACK_OVERFLOW);
+    ASSERT_EQ(header.state.SP, 15);
+    ASSERT_EQ(records.size(), 17);
+    ASSERT_EQ(records.back().PC, 0x202);
+    remove(path);
+}
+
+// FX15/FX18/FX07: timers tick once per IPF cycles
+TEST_F(Chip8Test, TIMERS) {
+    // LD V0, 3; LD DT, V0; LD ST, V0; loop: LD V1, DT; JP loop
+    unsigned char rom[] = {0x60, 0x03, 0xF0, 0x15, 0xF0, 0x18, 0xF1, 0x07, 0x12, 0x06};
+    chip8a->set_IPF(4);
+    chip8a->load_rom(rom, sizeof(rom));
+
+    ASSERT_EQ(chip8a->run_frame(), 0);
+    ASSERT_EQ(chip8a->delay_timer(), 2);
+    ASSERT_EQ(chip8a->reg_dump()[1], 3); // read before the frame ended
+    ASSERT_TRUE(chip8a->sound());
+    ASSERT_EQ(chip8a->cycles_to_timer_expiry(), 8);
+
+    chip8a->run_frame();
+    chip8a->run_frame();
+    ASSERT_EQ(chip8a->delay_timer(), 0);
+    ASSERT_EQ(chip8a->reg_dump()[1], 1);
+    ASSERT_FALSE(chip8a->sound());
+    ASSERT_EQ(chip8a->cycles_to_timer_expiry(), UINT64_MAX);
+
+    Chip8State state;
+    chip8a->set_opcode(0x6009);
+    chip8a->decode_and_execute();
+    chip8a->set_opcode(0xF015);
+    chip8a->decode_and_execute();
+    chip8a->save_state(&state);
+    ASSERT_EQ(state.DT, 9);
+}
+
+// 1NNN jumping to itself ends the frame early
+TEST_F(Chip8Test, IDLE_SKIP) {
+    unsigned char rom[] = {0x12, 0x00};
+    chip8a->set_IPF(1000);
+    chip8a->load_rom(rom, sizeof(rom));
+
+    ASSERT_EQ(chip8a->run_frame(), 0);
+    ASSERT_EQ(chip8a->cycles_dump(), 1000);
+    ASSERT_EQ(chip8a->trace_count(), 1);
+}
+
 
-int main(int argc, char* argv[]) {
-    ::testing::InitGoogleTest(&argc, argv);
+// reset() goes back to the post-load_rom image: RAM the program wrote,
+// registers, stack, screen and timers all return to their initial values
+TEST_F(Chip8Test, RESET) {
+    unsigned char rom[] = {
+            0x60, 0x2A, // LD V0, 0x2A
+            0xA3, 0x10, // LD I, 0x310
+            0xF0, 0x55, // LD [I], V0
+            0xAF, 0xFE, // LD I, 0xFFE
+            0xF0, 0x33, // LD B, V0 (wraps to 0x000)
+            0xF0, 0x15, // LD DT, V0
+            0xD0, 0x05, // DRW V0, V0, 5
+            0x22, 0x16, // CALL 0x216
+            0x12, 0x12, // JP 0x212
+            0x12, 0x12, // JP 0x212
+            0x00, 0x00,
+            0xC1, 0xFF, // RND V1, 0xFF
+            0x12, 0x16, // JP 0x216
+    };
+    ASSERT_EQ(chip8a->load_rom(rom, sizeof(rom)), 0);
+    Chip8State fresh;
+    chip8a->save_state(&fresh);
+
+    for (int i = 0; i < 9; i++)
+        ASSERT_EQ(chip8a->cycle(), 0);
+    uint8_t first_rnd = chip8a->reg_dump()[1];
+    ASSERT_EQ(chip8a->ram_dump()[0x310], 0x2A);
+    ASSERT_EQ(chip8a->SP_dump(), 1);
+    chip8a->press_key(3);
+
+    chip8a->reset();
+    Chip8State after;
+    chip8a->save_state(&after);
+    ASSERT_EQ(memcmp(after.RAM, fresh.RAM, RAM_SIZE), 0);
+    ASSERT_EQ(memcmp(after.screen, fresh.screen, SCREEN_SIZE), 0);
+    ASSERT_EQ(memcmp(after.stack, fresh.stack, sizeof(fresh.stack)), 0);
+    ASSERT_EQ(after.PC, PC_OFFSET);
+    ASSERT_EQ(after.SP, 0);
+    ASSERT_EQ(after.DT, 0);
+    ASSERT_EQ(chip8a->keypad_dump()[3], 0);
+
+    // same run again, including the random draw
+    for (int i = 0; i < 9; i++)
+        ASSERT_EQ(chip8a->cycle(), 0);
+    ASSERT_EQ(chip8a->reg_dump()[1], first_rnd);
+
+    // a shorter ROM does not inherit the tail of the longer one
+    unsigned char small[] = {0x12, 0x00};
+    chip8a->reset();
+    chip8a->load_rom(small, sizeof(small));
+    ASSERT_EQ(chip8a->ram_dump()[PC_OFFSET + 2], 0);
+}
 
-    Chip8* chip8 = (Chip8*) new Chip8(LOOP_FREQ, P_CHIP8, time(nullptr));
+static void expect_hashes_fresh(Chip8* chip8) {
+    Chip8State state;
+    chip8->save_state(&state);
+    ASSERT_EQ(chip8->state_hash(), chip8_state_hash(&state));
+    for (int page = 0; page < RAM_PAGES; page++)
+        ASSERT_EQ(chip8->page_hash(page), ram_page_hash(state.RAM, page)) << page;
+}
 
-    SDL_RWops *file = nullptr;
-    if (!(file = SDL_RWFromFile(argv[1], "rb"))) {
-        SDL_Log("Error: ROM file not found\n");
-        return 1;
+// The incrementally kept hash always matches one computed from scratch,
+// through stores, sprites, clears, load_state and reset.
+TEST_F(Chip8Test, StateHash) {
+    RomGenConfig cfg = {ROMGEN_MAX_SIZE, {3, 1, 2, 1, 1, 1}, 7};
+    uint8_t rom[ROMGEN_MAX_SIZE];
+    int size;
+    ASSERT_EQ(romgen_generate(&cfg, rom, &size), 0);
+    ASSERT_EQ(chip8a->load_rom(rom, size), 0);
+    chip8a->set_IPF(200);
+    expect_hashes_fresh(chip8a);
+    uint64_t fresh = chip8a->state_hash();
+
+    Chip8State mid;
+    for (int frame = 0; frame < 120; frame++) {
+        ASSERT_EQ(chip8a->run_frame(), 0);
+        expect_hashes_fresh(chip8a);
+        if (frame == 30)
+            chip8a->save_state(&mid);
     }
-    uint8_t buff[MAX_ROM_SIZE];
-    SDL_RWread(file, buff, 1, MAX_ROM_SIZE);
-    SDL_RWclose(file);
+    chip8a->load_state(&mid);
+    expect_hashes_fresh(chip8a);
+    EXPECT_EQ(chip8a->state_hash(), chip8_state_hash(&mid));
+
+    chip8a->reset();
+    expect_hashes_fresh(chip8a);
+    EXPECT_EQ(chip8a->state_hash(), fresh);
+
+    chip8a->load_state(&mid);
+    chip8a->set_opcode(0x00E0);
+    chip8a->decode_and_execute();
+    expect_hashes_fresh(chip8a);
+}
 
-    // load program into chip8 memory
-    chip8->load_rom(buff, MAX_ROM_SIZE);
+// ROM pages are hashed lazily; reloading and writing to them before any
+// hash is asked for must not leave a stale value behind.
+TEST_F(Chip8Test, StateHashAfterReload) {
+    RomGenConfig cfg = {ROMGEN_MAX_SIZE, {1, 0, 1, 1, 0, 1}, 3};
+    uint8_t rom[ROMGEN_MAX_SIZE];
+    int size;
+    ASSERT_EQ(romgen_generate(&cfg, rom, &size), 0);
+    chip8a->set_IPF(200);
+
+    chip8a->load_rom(rom, size);
+    for (int frame = 0; frame < 10; frame++)
+        ASSERT_EQ(chip8a->run_frame(), 0);
+    expect_hashes_fresh(chip8a);
+
+    chip8a->reset();
+    chip8a->load_rom(rom, size / 2);
+    chip8a->poke(PC_OFFSET + 1, 0x42);
+    chip8a->reset();
+    expect_hashes_fresh(chip8a);
+    chip8a->poke(PC_OFFSET + 3, 0x42);
+    expect_hashes_fresh(chip8a);
+    chip8a->reset();
+    expect_hashes_fresh(chip8a);
+}
 
-    return RUN_ALL_TESTS();
+TEST_F(Chip8Test, DiffPages) {
+    Chip8 other(LOOP_FREQ, P_CHIP8, 0);
+    EXPECT_EQ(chip8a->diff_pages(&other), 0);
+    EXPECT_EQ(chip8a->state_hash(), other.state_hash());
+
+    other.poke(0x345, 1);
+    other.poke(0xF00, 2);
+    EXPECT_EQ(chip8a->diff_pages(&other), (1 << 3) | (1 << 0xF));
+    EXPECT_NE(chip8a->state_hash(), other.state_hash());
+
+    // writing the old values back restores the old hashes
+    other.poke(0x345, 0);
+    other.poke(0xF00, 0);
+    EXPECT_EQ(chip8a->diff_pages(&other), 0);
+    EXPECT_EQ(chip8a->state_hash(), other.state_hash());
 }
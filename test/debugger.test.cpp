@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include "debugger.h"
+
+// 0x200: LD V0, 5
+// 0x202: LD I, 0x300
+// 0x204: CALL 0x210
+// 0x206: ADD V0, 1
+// 0x208: JP 0x208
+// 0x210: LD B, V0
+// 0x212: RET
+static unsigned char program[] = {
+        0x60, 0x05, 0xA3, 0x00, 0x22, 0x10, 0x70, 0x01,
+        0x12, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0xF0, 0x33, 0x00, 0xEE,
+};
+
+class DebuggerTest : public testing::Test {
+protected:
+    Chip8* chip8a = (Chip8*) new Chip8(LOOP_FREQ, P_CHIP8, time(nullptr));
+    Debugger* dbg = new Debugger(chip8a);
+
+    void SetUp() override {
+        chip8a->load_rom(program, sizeof(program));
+    }
+
+    void TearDown() override {
+        delete dbg;
+        delete chip8a;
+    }
+};
+
+TEST_F(DebuggerTest, Unarmed) {
+    ASSERT_FALSE(dbg->armed());
+    ASSERT_EQ(dbg->run(100), 0);
+    ASSERT_EQ(dbg->break_reason(), BREAK_NONE);
+    ASSERT_EQ(chip8a->PC_dump(), 0x208);
+}
+
+TEST_F(DebuggerTest, Breakpoint) {
+    dbg->add_breakpoint(0x206);
+    ASSERT_TRUE(dbg->has_breakpoint(0x206));
+    ASSERT_EQ(dbg->run(100), 0);
+    ASSERT_EQ(dbg->break_reason(), BREAK_BREAKPOINT);
+    ASSERT_EQ(chip8a->PC_dump(), 0x206);
+
+    // resuming executes the instruction under the breakpoint
+    dbg->run(1);
+    ASSERT_EQ(chip8a->PC_dump(), 0x208);
+
+    dbg->remove_breakpoint(0x206);
+    ASSERT_FALSE(dbg->armed());
+}
+
+TEST_F(DebuggerTest, Watchpoint) {
+    dbg->add_watchpoint(0x301, 1, WATCH_WRITE);
+    ASSERT_EQ(dbg->run(100), 0);
+    ASSERT_EQ(dbg->break_reason(), BREAK_WATCHPOINT);
+    ASSERT_EQ(dbg->break_addr(), 0x301);
+    ASSERT_EQ(chip8a->PC_dump(), 0x210);
+
+    // read watchpoints ignore the BCD write
+    dbg->clear_watchpoints();
+    dbg->add_watchpoint(0x300, 3, WATCH_READ);
+    dbg->run(100);
+    ASSERT_EQ(dbg->break_reason(), BREAK_NONE);
+}
+
+// Stores with I near or past the top of RAM land at 0x000 onwards, as in
+// the interpreter.
+TEST_F(DebuggerTest, WatchpointWrapsAround) {
+    // 0x200: LD I, 0xFFE; LD [I], V3; JP 0x204   writes 0xFFE..0x001
+    unsigned char across[] = {0xAF, 0xFE, 0xF3, 0x55, 0x12, 0x04};
+    chip8a->load_rom(across, sizeof(across));
+    dbg->add_watchpoint(0x000, 1, WATCH_WRITE);
+    ASSERT_EQ(dbg->run(100), 0);
+    ASSERT_EQ(dbg->break_reason(), BREAK_WATCHPOINT);
+    ASSERT_EQ(dbg->break_addr(), 0x000);
+    ASSERT_EQ(chip8a->PC_dump(), 0x202);
+
+    // 0x200: LD V0, 4; LD I, 0xFFE; ADD I, V0; LD [I], V0; JP 0x208   writes 0x002
+    unsigned char past[] = {0x60, 0x04, 0xAF, 0xFE, 0xF0, 0x1E, 0xF0, 0x55, 0x12, 0x08};
+    chip8a->reset();
+    chip8a->load_rom(past, sizeof(past));
+    dbg->clear_watchpoints();
+    dbg->add_watchpoint(0x002, 1, WATCH_WRITE);
+    ASSERT_EQ(dbg->run(100), 0);
+    ASSERT_EQ(dbg->break_reason(), BREAK_WATCHPOINT);
+    ASSERT_EQ(dbg->break_addr(), 0x002);
+    ASSERT_EQ(chip8a->PC_dump(), 0x206);
+}
+
+TEST_F(DebuggerTest, WatchIndex) {
+    dbg->watch_index(true);
+    dbg->run(100);
+    ASSERT_EQ(dbg->break_reason(), BREAK_INDEX);
+    ASSERT_EQ(chip8a->PC_dump(), 0x202);
+}
+
+TEST_F(DebuggerTest, Condition) {
+    dbg->add_condition(0x0, COND_EQ, 6);
+    dbg->run(100);
+    ASSERT_EQ(dbg->break_reason(), BREAK_CONDITION);
+    ASSERT_EQ(chip8a->PC_dump(), 0x208);
+}
+
+TEST_F(DebuggerTest, StepOverAndReturn) {
+    dbg->step();
+    dbg->step();
+    ASSERT_EQ(dbg->break_reason(), BREAK_STEP);
+    dbg->step_over(100);
+    ASSERT_EQ(chip8a->PC_dump(), 0x206);
+    ASSERT_EQ(chip8a->SP_dump(), 0);
+    ASSERT_EQ(chip8a->ram_dump()[0x302], 5);
+
+    chip8a->load_rom(program, sizeof(program));
+    chip8a->set_opcode(0x1204);
+    chip8a->decode_and_execute();
+    dbg->step();
+    ASSERT_EQ(chip8a->PC_dump(), 0x210);
+    dbg->run_to_return(100);
+    ASSERT_EQ(dbg->break_reason(), BREAK_STEP);
+    ASSERT_EQ(chip8a->PC_dump(), 0x206);
+}
+
+TEST(Disassembler, Mnemonics) {
+    char buff[32];
+    ASSERT_EQ(disassemble(0xD125, buff, sizeof(buff)), 0);
+    ASSERT_STREQ(buff, "DRW V1, V2, 5");
+    ASSERT_EQ(disassemble(0x00EE, buff, sizeof(buff)), 0);
+    ASSERT_STREQ(buff, "RET");
+    ASSERT_EQ(disassemble(0xFA65, buff, sizeof(buff)), 0);
+    ASSERT_STREQ(buff, "LD VA, [I]");
+    ASSERT_EQ(disassemble(0x8008, buff, sizeof(buff)), -1);
+    ASSERT_STREQ(buff, "DW 0x8008");
+}
@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+#include "explore.h"
+
+// 0x200: LD V0, 5
+// 0x202: SKP V0
+// 0x204: JP 0x202
+// 0x206: LD V1, 1    only reachable by holding key 5
+// 0x208: JP 0x208
+static unsigned char program[] = {
+        0x60, 0x05, 0xE0, 0x9E, 0x12, 0x02, 0x61, 0x01, 0x12, 0x08,
+};
+
+TEST(Explore, ReachesGatedCode) {
+    Chip8 chip8(LOOP_FREQ, P_CHIP8, 1);
+    chip8.load_rom(program, sizeof(program));
+
+    ExploreConfig cfg = {2, 20000, 30, 1000, 42};
+    ExploreReport report;
+    ASSERT_EQ(explore_run(&chip8, &cfg, &report), 0);
+
+    EXPECT_GE(report.frames, 20000);
+    EXPECT_EQ(report.faults, 0);
+    EXPECT_GE(report.cells, 2);
+    for (int pc = 0x200; pc <= 0x208; pc += 2)
+        EXPECT_TRUE((report.coverage[pc >> 6] >> (pc & 63)) & 1) << std::hex << pc;
+    EXPECT_FALSE((report.coverage[0x20A >> 6] >> (0x20A & 63)) & 1);
+}
+
+// More instructions per frame than the trace ring holds: PCs from early in
+// the frame still count.
+TEST(Explore, CoverageAboveTraceSize) {
+    unsigned char rom[1002];
+    for (int i = 0; i < 1000; i += 2) {
+        rom[i] = 0x60;
+        rom[i + 1] = 0x01;
+    }
+    rom[1000] = 0x15; // JP 0x5E8, itself
+    rom[1001] = 0xE8;
+
+    Chip8 chip8(LOOP_FREQ, P_CHIP8, 1);
+    chip8.set_IPF(1000);
+    chip8.load_rom(rom, sizeof(rom));
+
+    ExploreConfig cfg = {1, 100, 10, 100, 42};
+    ExploreReport report;
+    ASSERT_EQ(explore_run(&chip8, &cfg, &report), 0);
+    for (int pc = 0x200; pc <= 0x5E8; pc += 2)
+        ASSERT_TRUE((report.coverage[pc >> 6] >> (pc & 63)) & 1) << std::hex << pc;
+}
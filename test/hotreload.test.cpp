@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include "hotreload.h"
+
+#include <cstdio>
+#include <unistd.h>
+
+static void write_file(const std::string& path, const uint8_t* data, size_t size) {
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char*) data, size);
+}
+
+TEST(HotReload, NoticesWriteAndRename) {
+    char dir[] = "/tmp/chip8_watch_XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+    std::string rom = std::string(dir) + "/game.ch8";
+    std::string other = std::string(dir) + "/other.ch8";
+    std::string tmp = std::string(dir) + "/game.ch8.tmp";
+    uint8_t bytes[] = {0x12, 0x00};
+    write_file(rom, bytes, sizeof(bytes));
+
+    RomWatch watch;
+    ASSERT_EQ(romwatch_create(&watch, rom.c_str()), 0);
+    EXPECT_EQ(romwatch_poll(&watch), 0);
+
+    write_file(rom, bytes, sizeof(bytes));
+    EXPECT_EQ(romwatch_poll(&watch), 1);
+    EXPECT_EQ(romwatch_poll(&watch), 0);
+
+    write_file(other, bytes, sizeof(bytes));
+    EXPECT_EQ(romwatch_poll(&watch), 0);
+
+    // editors that save atomically
+    write_file(tmp, bytes, sizeof(bytes));
+    romwatch_poll(&watch);
+    ASSERT_EQ(rename(tmp.c_str(), rom.c_str()), 0);
+    EXPECT_EQ(romwatch_poll(&watch), 1);
+
+    romwatch_destroy(&watch);
+    unlink(rom.c_str());
+    unlink(other.c_str());
+    rmdir(dir);
+}
+
+TEST(HotReload, ApplyFreshAndResume) {
+    // V0 += 1 each loop, stored at 0x300
+    uint8_t v1[] = {0x70, 0x01, 0xA3, 0x00, 0xF0, 0x55, 0x12, 0x00};
+    // same loop, adding 0x10
+    uint8_t v2[] = {0x70, 0x10, 0xA3, 0x00, 0xF0, 0x55, 0x12, 0x00};
+
+    Chip8 chip8(EMU_FREQ, P_CHIP8, 0);
+    chip8.load_rom(v1, sizeof(v1));
+    for (int i = 0; i < 4 * 5; i++)
+        ASSERT_EQ(chip8.cycle(), 0);
+    ASSERT_EQ(chip8.reg_dump()[0], 5);
+
+    Chip8State checkpoint;
+    chip8.save_state(&checkpoint);
+    int checkpoint_rom_size = chip8.rom_size_dump();
+
+    ASSERT_EQ(hotreload_apply(&chip8, v2, sizeof(v2), nullptr, 0), 0);
+    EXPECT_EQ(chip8.PC_dump(), PC_OFFSET);
+    EXPECT_EQ(chip8.reg_dump()[0], 0);
+    EXPECT_EQ(chip8.ram_dump()[0x300], 0);
+    EXPECT_EQ(chip8.ram_dump()[PC_OFFSET + 1], 0x10);
+
+    ASSERT_EQ(hotreload_apply(&chip8, v2, sizeof(v2), &checkpoint, checkpoint_rom_size), 0);
+    EXPECT_EQ(chip8.reg_dump()[0], 5);
+    EXPECT_EQ(chip8.ram_dump()[0x300], 5);
+    for (int i = 0; i < 4; i++)
+        ASSERT_EQ(chip8.cycle(), 0);
+    EXPECT_EQ(chip8.reg_dump()[0], 0x15);
+
+    // a later reset goes back to the new ROM, not the checkpoint
+    chip8.reset();
+    EXPECT_EQ(chip8.ram_dump()[0x300], 0);
+    EXPECT_EQ(chip8.ram_dump()[PC_OFFSET + 1], 0x10);
+
+    // resuming on a shorter ROM does not bring the old tail back
+    uint8_t v3[] = {0x12, 0x00};
+    ASSERT_EQ(hotreload_apply(&chip8, v3, sizeof(v3), &checkpoint, checkpoint_rom_size), 0);
+    EXPECT_EQ(chip8.ram_dump()[PC_OFFSET], 0x12);
+    for (int i = sizeof(v3); i < (int) sizeof(v1); i++)
+        EXPECT_EQ(chip8.ram_dump()[PC_OFFSET + i], 0) << i;
+}
+
+// The checkpoint was taken under a longer ROM than the one running when the
+// reload comes in, so its tail must be cleared from the checkpoint's RAM.
+TEST(HotReload, ResumeShorterRomTwice) {
+    uint8_t v1[100];
+    memset(v1, 0xAA, sizeof(v1));
+    v1[0] = 0x12; // JP 0x200
+    v1[1] = 0x00;
+    uint8_t v2[50];
+    memset(v2, 0, sizeof(v2));
+    v2[0] = 0x12;
+    v2[1] = 0x00;
+
+    Chip8 chip8(EMU_FREQ, P_CHIP8, 0);
+    chip8.load_rom(v1, sizeof(v1));
+    Chip8State checkpoint;
+    chip8.save_state(&checkpoint);
+    int checkpoint_rom_size = chip8.rom_size_dump();
+
+    for (int reload = 0; reload < 2; reload++) {
+        ASSERT_EQ(hotreload_apply(&chip8, v2, sizeof(v2), &checkpoint, checkpoint_rom_size), 0);
+        for (int i = sizeof(v2); i < (int) sizeof(v1); i++)
+            ASSERT_EQ(chip8.ram_dump()[PC_OFFSET + i], 0) << reload << " " << i;
+    }
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include "ramsearch.h"
+
+// Runs the same sequence of snapshots and predicates through a SIMD level
+// and the scalar kernel and expects the same surviving addresses.
+static void compare_levels(SimdLevel level) {
+    if (detect_simd() < level)
+        return;
+
+    auto simd = std::make_unique<RamSearch>();
+    auto scalar = std::make_unique<RamSearch>();
+    ramsearch_reset(simd.get());
+    ramsearch_reset(scalar.get());
+    simd->simd = level;
+    scalar->simd = SIMD_NONE;
+
+    std::mt19937 gen(99);
+    uint8_t ram[RAM_SIZE];
+    for (unsigned char& b : ram)
+        b = gen();
+
+    const SearchPredicate preds[] = {SEARCH_CHANGED, SEARCH_INCREASED, SEARCH_EQUAL, SEARCH_DECREASED, SEARCH_VALUE};
+    for (int round = 0; round < 12; round++) {
+        for (int i = 0; i < RAM_SIZE; i++)
+            if (gen() % 4 == 0) ram[i] += (int) (gen() % 7) - 3;
+        SearchPredicate pred = preds[round % 5];
+        uint8_t value = ram[gen() % RAM_SIZE];
+
+        ramsearch_filter(simd.get(), ram, pred, value);
+        ramsearch_filter(scalar.get(), ram, pred, value);
+        ASSERT_EQ(simd->count, scalar->count);
+
+        uint16_t a[RAM_SIZE], b[RAM_SIZE];
+        int n = ramsearch_results(simd.get(), a, RAM_SIZE);
+        ASSERT_EQ(n, ramsearch_results(scalar.get(), b, RAM_SIZE));
+        ASSERT_EQ(memcmp(a, b, n * sizeof(uint16_t)), 0);
+        for (int i = 0; i < n; i++) {
+            ASSERT_TRUE(pred != SEARCH_VALUE || ram[a[i]] == value);
+        }
+    }
+}
+
+TEST(RamSearch, SSE2MatchesScalar) {
+    compare_levels(SIMD_SSE2);
+}
+
+TEST(RamSearch, AVX2MatchesScalar) {
+    compare_levels(SIMD_AVX2);
+}
+
+// A counter the program decrements every frame is found by successive
+// "decreased" filters over saved states, then frozen with a cheat.
+TEST(RamSearch, FindAndFreezeCounter) {
+    // V0 = 0x40; V1 = 1; loop: V0 -= V1; I = 0x300; store V0; jump loop
+    uint8_t rom[] = {0x60, 0x40, 0x61, 0x01, 0x80, 0x15, 0xA3, 0x00, 0xF0, 0x55, 0x12, 0x04};
+    Chip8 chip8(EMU_FREQ, P_CHIP8, 0);
+    chip8.set_IPF(4);
+    chip8.load_rom(rom, sizeof(rom));
+    chip8.run_frame(); // the first store lands in the second frame
+
+    Chip8State states[8];
+    for (auto& state : states) {
+        ASSERT_EQ(chip8.run_frame(), 0);
+        chip8.save_state(&state);
+    }
+
+    auto search = std::make_unique<RamSearch>();
+    ramsearch_reset(search.get());
+    ramsearch_filter_states(search.get(), states, 8, SEARCH_DECREASED, 0);
+
+    uint16_t addrs[SEARCH_LIST_MAX];
+    ASSERT_EQ(ramsearch_results(search.get(), addrs, SEARCH_LIST_MAX), 1);
+    EXPECT_EQ(addrs[0], 0x300);
+
+    CheatList cheats = {};
+    ASSERT_EQ(cheats_add(&cheats, 0x300, 0x7F, true), 0);
+    ASSERT_EQ(cheats_add(&cheats, 0x301, 0x11, false), 0);
+    chip8.run_frame();
+    cheats_apply(&cheats, &chip8);
+    EXPECT_EQ(chip8.ram_dump()[0x300], 0x7F);
+    EXPECT_EQ(chip8.ram_dump()[0x301], 0x11);
+    EXPECT_EQ(cheats.count, 1); // the one-shot poke is gone
+
+    cheats_remove(&cheats, 0x300);
+    EXPECT_EQ(cheats.count, 0);
+}
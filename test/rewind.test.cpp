@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include "rewind.h"
+
+// Counts V0 up, stores it and draws its low digit at (0, 0) every frame, so
+// RAM, screen and registers all change.
+static uint8_t busy_rom[] = {
+        0x70, 0x01, // ADD V0, 1
+        0xA3, 0x00, // LD I, 0x300
+        0xF0, 0x55, // LD [I], V0
+        0x00, 0xE0, // CLS
+        0x61, 0x0F, // LD V1, 0xF
+        0x81, 0x02, // AND V1, V0
+        0xF1, 0x29, // LD F, V1
+        0xD3, 0x35, // DRW V3, V3, 5
+        0xF0, 0x15, // LD DT, V0
+        0x12, 0x00, // JP 0x200
+};
+
+static void expect_state(Chip8* chip8, const Chip8State* want) {
+    Chip8State got;
+    chip8->save_state(&got);
+    ASSERT_EQ(memcmp(got.RAM, want->RAM, RAM_SIZE), 0);
+    ASSERT_EQ(memcmp(got.screen, want->screen, SCREEN_SIZE), 0);
+    ASSERT_EQ(memcmp(got.V, want->V, sizeof(got.V)), 0);
+    ASSERT_EQ(got.PC, want->PC);
+    ASSERT_EQ(got.I, want->I);
+    ASSERT_EQ(got.DT, want->DT);
+}
+
+TEST(Rewind, StepsBackThroughEveryFrame) {
+    Chip8 chip8(EMU_FREQ, P_CHIP8, 0);
+    chip8.set_IPF(10);
+    chip8.load_rom(busy_rom, sizeof(busy_rom));
+
+    Rewind rw;
+    ASSERT_EQ(rewind_create(&rw, 1 << 20), 0);
+    std::vector<Chip8State> states(100);
+    for (auto& state : states) {
+        ASSERT_EQ(chip8.run_frame(), 0);
+        chip8.save_state(&state);
+        rewind_push(&rw, &chip8);
+    }
+    EXPECT_EQ(rw.frames, 99);
+
+    for (int i = 98; i >= 0; i--) {
+        ASSERT_EQ(rewind_step_back(&rw, &chip8), 0);
+        expect_state(&chip8, &states[i]);
+    }
+    EXPECT_EQ(rewind_step_back(&rw, &chip8), 1);
+    expect_state(&chip8, &states[0]);
+
+    // history continues from wherever we rewound to
+    ASSERT_EQ(chip8.run_frame(), 0);
+    rewind_push(&rw, &chip8);
+    ASSERT_EQ(rewind_step_back(&rw, &chip8), 0);
+    expect_state(&chip8, &states[0]);
+    rewind_destroy(&rw);
+}
+
+TEST(Rewind, BudgetEvictsOldestFrames) {
+    Chip8 chip8(EMU_FREQ, P_CHIP8, 0);
+    chip8.set_IPF(10);
+    chip8.load_rom(busy_rom, sizeof(busy_rom));
+
+    Rewind rw;
+    ASSERT_EQ(rewind_create(&rw, 16 << 10), 0);
+    std::vector<Chip8State> states(2000);
+    for (auto& state : states) {
+        ASSERT_EQ(chip8.run_frame(), 0);
+        chip8.save_state(&state);
+        rewind_push(&rw, &chip8);
+    }
+    ASSERT_GT(rw.frames, 0);
+    ASSERT_LT(rw.frames, 1999);
+    EXPECT_LE(rw.used, rw.capacity);
+
+    int kept = rw.frames;
+    while (rewind_step_back(&rw, &chip8) == 0) {}
+    expect_state(&chip8, &states[1999 - kept]);
+    rewind_destroy(&rw);
+}
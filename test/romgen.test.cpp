@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+#include "romgen.h"
+
+static RomGenConfig single(Workload w, uint64_t seed) {
+    RomGenConfig cfg = {ROMGEN_MAX_SIZE, {}, seed};
+    cfg.mix[w] = 1;
+    return cfg;
+}
+
+TEST(RomGen, Deterministic) {
+    RomGenConfig cfg = {1024, {3, 1, 2, 1, 1, 1}, 42};
+    uint8_t a[ROMGEN_MAX_SIZE], b[ROMGEN_MAX_SIZE];
+    int size_a, size_b;
+    ASSERT_EQ(romgen_generate(&cfg, a, &size_a), 0);
+    ASSERT_EQ(romgen_generate(&cfg, b, &size_b), 0);
+    ASSERT_EQ(size_a, size_b);
+    EXPECT_LE(size_a, 1024);
+    EXPECT_EQ(memcmp(a, b, size_a), 0);
+
+    cfg.seed = 43;
+    ASSERT_EQ(romgen_generate(&cfg, b, &size_b), 0);
+    EXPECT_NE(memcmp(a, b, std::min(size_a, size_b)), 0);
+
+    RomGenConfig bad = {1024, {}, 42};
+    EXPECT_EQ(romgen_generate(&bad, a, &size_a), 1);
+}
+
+// Every workload runs for a few seconds of emulated time without faulting,
+// never leaves the ROM and only writes to the scratch page or, for SMC, to
+// its own code.
+TEST(RomGen, WorkloadsRunClean) {
+    for (int w = 0; w < WORKLOAD_COUNT; w++) {
+        for (uint64_t seed = 1; seed <= 4; seed++) {
+            RomGenConfig cfg = single((Workload) w, seed);
+            uint8_t rom[ROMGEN_MAX_SIZE];
+            int size;
+            ASSERT_EQ(romgen_generate(&cfg, rom, &size), 0);
+
+            Chip8 chip8(EMU_FREQ, P_CHIP8, seed);
+            chip8.load_rom(rom, size);
+            for (int i = 0; i < 60 * 200; i++) {
+                ASSERT_EQ(chip8.cycle(), 0) << workload_name((Workload) w) << " seed " << seed;
+                uint16_t pc = chip8.PC_dump();
+                ASSERT_TRUE(pc >= PC_OFFSET && pc < PC_OFFSET + size) << workload_name((Workload) w);
+            }
+            if (w != WORKLOAD_SMC) {
+                EXPECT_EQ(memcmp(chip8.ram_dump() + PC_OFFSET, rom, size), 0) << workload_name((Workload) w);
+            }
+        }
+    }
+}
@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+#include "server.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// 0x200: LD V0, 0; LD F, V0; DRW V0, V0, 5; JP 0x206   draws a 14 pixel "0"
+static unsigned char glyph_rom[] = {0x60, 0x00, 0xF0, 0x29, 0xD0, 0x05, 0x12, 0x06};
+
+// Draws its own first 15 bytes across the whole top of the screen, 200 pixels.
+static unsigned char stripe_rom[] = {
+        0xA2, 0x00, // LD I, 0x200
+        0xD0, 0x1F, // DRW V0, V1, 15
+        0x70, 0x08, // ADD V0, 8
+        0x30, 0x40, // SE V0, 64
+        0x12, 0x02, // JP 0x202
+        0x12, 0x0A, // JP 0x20A
+};
+
+// V0 += 1 forever
+static unsigned char count_rom[] = {0x70, 0x01, 0x12, 0x00};
+
+class ServerTest : public testing::Test {
+protected:
+    std::string path = "/tmp/chip8_server_test_" + std::to_string(getpid()) + ".sock";
+    Chip8Server server;
+    std::thread loop;
+
+    void start(int workers) {
+        ASSERT_EQ(server.start(path.c_str(), workers), 0);
+        loop = std::thread([this] { server.run(); });
+    }
+
+    void TearDown() override {
+        server.stop();
+        if (loop.joinable())
+            loop.join();
+    }
+
+    int connect_client() {
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, path.c_str());
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (sockaddr*) &addr, sizeof(addr))) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+};
+
+static void send_msg(int fd, uint8_t type, uint32_t session, const void* payload, uint16_t len) {
+    std::string msg;
+    MsgHeader hdr = {type, 0, len, session};
+    msg.append((const char*) &hdr, sizeof(hdr));
+    msg.append((const char*) payload, len);
+    ASSERT_EQ(write(fd, msg.data(), msg.size()), (ssize_t) msg.size());
+}
+
+static bool read_full(int fd, void* buff, size_t len) {
+    auto* p = (uint8_t*) buff;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static MsgHeader recv_msg(int fd, std::string* payload) {
+    MsgHeader hdr = {};
+    if (!read_full(fd, &hdr, sizeof(hdr)))
+        return {};
+    payload->resize(hdr.len);
+    if (!read_full(fd, payload->data(), hdr.len))
+        return {};
+    return hdr;
+}
+
+static uint32_t create_session(int fd, uint32_t freq, const unsigned char* rom, uint16_t size) {
+    uint8_t args[13] = {};
+    memcpy(args, &freq, 4);
+    args[4] = P_CHIP8;
+    send_msg(fd, CMD_CREATE, 0, args, sizeof(args));
+    std::string payload;
+    MsgHeader hdr = recv_msg(fd, &payload);
+    if (hdr.type != MSG_CREATED)
+        return 0;
+    send_msg(fd, CMD_LOAD_ROM, hdr.session, rom, size);
+    if (recv_msg(fd, &payload).type != MSG_OK)
+        return 0;
+    return hdr.session;
+}
+
+TEST_F(ServerTest, SessionLifecycle) {
+    start(2);
+    int fd = connect_client();
+    ASSERT_GE(fd, 0);
+    std::string payload;
+    uint16_t frames = 1;
+
+    // few pixels change: sent as a list of indices
+    uint32_t glyph = create_session(fd, EMU_FREQ, glyph_rom, sizeof(glyph_rom));
+    ASSERT_NE(glyph, 0);
+    send_msg(fd, CMD_STEP, glyph, &frames, 2);
+    MsgHeader hdr = recv_msg(fd, &payload);
+    ASSERT_EQ(hdr.type, MSG_FRAME);
+    ASSERT_EQ(hdr.session, glyph);
+    EXPECT_EQ(payload[0], 0);
+    ASSERT_EQ(payload[1], DELTA_LIST);
+    uint16_t count;
+    memcpy(&count, &payload[2], 2);
+    EXPECT_EQ(count, 14);
+    ASSERT_EQ(payload.size(), 4u + count * 2);
+    std::vector<uint16_t> pixels(count);
+    memcpy(pixels.data(), &payload[4], count * 2);
+
+    send_msg(fd, CMD_SNAPSHOT, glyph, nullptr, 0);
+    hdr = recv_msg(fd, &payload);
+    ASSERT_EQ(hdr.type, MSG_SNAPSHOT);
+    ASSERT_EQ(payload.size(), sizeof(Chip8State));
+    auto* state = (const Chip8State*) payload.data();
+    EXPECT_EQ(state->PC, 0x206);
+    for (uint16_t pixel : pixels)
+        EXPECT_EQ(state->screen[pixel], 1) << pixel;
+    // struct padding goes out as zeros
+    for (size_t i = offsetof(Chip8State, SP) + 1; i < offsetof(Chip8State, I); i++)
+        EXPECT_EQ(payload[i], 0) << i;
+    for (size_t i = offsetof(Chip8State, ST) + 1; i < sizeof(Chip8State); i++)
+        EXPECT_EQ(payload[i], 0) << i;
+
+    // most of a row of sprites: sent as a bitmap
+    uint32_t stripe = create_session(fd, LOOP_FREQ * 100, stripe_rom, sizeof(stripe_rom));
+    ASSERT_NE(stripe, 0);
+    send_msg(fd, CMD_STEP, stripe, &frames, 2);
+    hdr = recv_msg(fd, &payload);
+    ASSERT_EQ(hdr.type, MSG_FRAME);
+    ASSERT_EQ(payload[1], DELTA_BITMAP);
+    ASSERT_EQ(payload.size(), 2u + SCREEN_SIZE / 8);
+    int toggled = 0;
+    for (size_t i = 2; i < payload.size(); i++)
+        toggled += __builtin_popcount((uint8_t) payload[i]);
+    EXPECT_EQ(toggled, 200);
+
+    send_msg(fd, CMD_DESTROY, glyph, nullptr, 0);
+    EXPECT_EQ(recv_msg(fd, &payload).type, MSG_OK);
+    send_msg(fd, CMD_SNAPSHOT, glyph, nullptr, 0);
+    EXPECT_EQ(recv_msg(fd, &payload).type, MSG_ERROR);
+    close(fd);
+}
+
+// A SNAPSHOT queued behind a STEP waits for it, and an out of range
+// emu_freq still runs instructions.
+TEST_F(ServerTest, PipelinedAfterStep) {
+    start(2);
+    int fd = connect_client();
+    ASSERT_GE(fd, 0);
+    std::string payload;
+
+    uint32_t id = create_session(fd, 0xFFFFFFFF, count_rom, sizeof(count_rom));
+    ASSERT_NE(id, 0);
+    uint16_t frames = 2;
+    send_msg(fd, CMD_STEP, id, &frames, 2);
+    send_msg(fd, CMD_SNAPSHOT, id, nullptr, 0);
+
+    EXPECT_EQ(recv_msg(fd, &payload).type, MSG_FRAME);
+    ASSERT_EQ(recv_msg(fd, &payload).type, MSG_SNAPSHOT);
+    auto* state = (const Chip8State*) payload.data();
+    EXPECT_GT(state->V[0], 0);
+    close(fd);
+}
+
+// The client goes away while its STEP is on a worker. With one worker the
+// second client's STEP only finishes after the abandoned one was reaped;
+// the sanitizer build catches a use after free or leak on that path.
+TEST_F(ServerTest, DisconnectDuringStep) {
+    start(1);
+    int gone = connect_client();
+    ASSERT_GE(gone, 0);
+    uint32_t id = create_session(gone, LOOP_FREQ * 1000, count_rom, sizeof(count_rom));
+    ASSERT_NE(id, 0);
+    uint16_t frames = 5000;
+    send_msg(gone, CMD_STEP, id, &frames, 2);
+    send_msg(gone, CMD_SNAPSHOT, id, nullptr, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    close(gone);
+
+    int fd = connect_client();
+    ASSERT_GE(fd, 0);
+    std::string payload;
+    uint32_t other = create_session(fd, EMU_FREQ, count_rom, sizeof(count_rom));
+    ASSERT_NE(other, 0);
+    frames = 1;
+    send_msg(fd, CMD_STEP, other, &frames, 2);
+    MsgHeader hdr = recv_msg(fd, &payload);
+    EXPECT_EQ(hdr.type, MSG_FRAME);
+    EXPECT_EQ(hdr.session, other);
+    close(fd);
+}
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include "shmexport.h"
+#include "shmread.h"
+
+#include <thread>
+#include <unistd.h>
+
+static std::string shm_name() {
+    return "/chip8_test_" + std::to_string(getpid());
+}
+
+// Every V register holds value; the screen is filled with it too.
+static void set_frame_state(Chip8* chip8, uint8_t value) {
+    Chip8State state = {};
+    memset(state.V, value, sizeof(state.V));
+    memset(state.screen, value, sizeof(state.screen));
+    state.PC = PC_OFFSET + value;
+    state.stack[15] = 0x200 + value;
+    chip8->load_state(&state);
+}
+
+TEST(ShmExport, PublishAndRead) {
+    std::string name = shm_name();
+    ShmExport ex;
+    ASSERT_EQ(shmexport_create(&ex, name.c_str()), 0);
+    ShmReader reader;
+    ASSERT_EQ(shmreader_open(&reader, name.c_str()), 0);
+
+    ExportFrame out;
+    EXPECT_EQ(shmreader_latest(&reader, &out), SHM_READ_PENDING);
+
+    Chip8 chip8(EMU_FREQ, P_CHIP8, 0);
+    for (uint64_t frame = 0; frame < SHM_EXPORT_SLOTS + 4; frame++) {
+        set_frame_state(&chip8, frame);
+        shmexport_publish(&ex, &chip8, frame);
+    }
+    EXPECT_EQ(shmreader_published(&reader), SHM_EXPORT_SLOTS + 4);
+
+    ASSERT_EQ(shmreader_latest(&reader, &out), SHM_READ_OK);
+    EXPECT_EQ(out.frame, SHM_EXPORT_SLOTS + 3);
+    EXPECT_EQ(out.PC, PC_OFFSET + SHM_EXPORT_SLOTS + 3);
+
+    ASSERT_EQ(shmreader_read(&reader, 5, &out), SHM_READ_OK);
+    EXPECT_EQ(out.frame, 5);
+    EXPECT_EQ(out.V[0xF], 5);
+    EXPECT_EQ(out.screen[SCREEN_SIZE - 1], 5);
+    EXPECT_EQ(out.stack[15], 0x205);
+
+    EXPECT_EQ(shmreader_read(&reader, 3, &out), SHM_READ_OVERWRITTEN);
+    EXPECT_EQ(shmreader_read(&reader, SHM_EXPORT_SLOTS + 4, &out), SHM_READ_PENDING);
+
+    // zero-copy, straight from the slot
+    uint32_t seq;
+    const ExportFrame* slot = shmreader_begin(&reader, 10, &seq);
+    ASSERT_NE(slot, nullptr);
+    uint8_t v = slot->V[3];
+    EXPECT_TRUE(shmreader_end(slot, 10, seq));
+    EXPECT_EQ(v, 10);
+    shmexport_publish(&ex, &chip8, 26);
+    EXPECT_FALSE(shmreader_end(slot, 10, seq));
+
+    shmreader_close(&reader);
+    shmexport_destroy(&ex);
+    EXPECT_NE(shmreader_open(&reader, name.c_str()), 0);
+}
+
+TEST(ShmExport, NoTornReads) {
+    std::string name = shm_name();
+    ShmExport ex;
+    ASSERT_EQ(shmexport_create(&ex, name.c_str()), 0);
+    ShmReader reader;
+    ASSERT_EQ(shmreader_open(&reader, name.c_str()), 0);
+
+    const uint64_t frames = 20000;
+    std::thread writer([&] {
+        Chip8 chip8(EMU_FREQ, P_CHIP8, 0);
+        for (uint64_t frame = 0; frame < frames; frame++) {
+            set_frame_state(&chip8, frame);
+            shmexport_publish(&ex, &chip8, frame);
+        }
+    });
+
+    // every frame read back must be the one that was published, whole
+    ExportFrame out;
+    int reads = 0;
+    int bad = 0;
+    while (shmreader_published(&reader) < frames) {
+        if (shmreader_latest(&reader, &out) != SHM_READ_OK)
+            continue;
+        uint8_t value = out.frame & 0xFF;
+        for (int i = 0; i < 16; i++)
+            bad += out.V[i] != value;
+        for (int i = 0; i < SCREEN_SIZE; i += 97)
+            bad += out.screen[i] != value;
+        reads++;
+    }
+    writer.join();
+
+    EXPECT_GT(reads, 0);
+    EXPECT_EQ(bad, 0);
+    shmreader_close(&reader);
+    shmexport_destroy(&ex);
+}
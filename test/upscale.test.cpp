@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include "upscale.h"
+
+// Renders the same random intensities through a SIMD path and the scalar
+// path and expects identical pixels.
+static void compare_paths(SimdLevel level, UpscaleFilter filter, int w, int h) {
+    Upscaler simd, scalar;
+    ASSERT_EQ(upscaler_create(&simd, w, h, filter, PHOSPHOR_DECAY), 0);
+    ASSERT_EQ(upscaler_create(&scalar, w, h, filter, PHOSPHOR_DECAY), 0);
+    if (simd.simd < level) {
+        upscaler_destroy(&simd);
+        upscaler_destroy(&scalar);
+        return;
+    }
+    simd.simd = level;
+    scalar.simd = SIMD_NONE;
+
+    std::mt19937 gen(1234);
+    uint8_t screen[SCREEN_SIZE];
+    for (int frame = 0; frame < 4; frame++) {
+        for (unsigned char& px : screen)
+            px = gen() % 3 == 0;
+        upscaler_blend(&simd, screen);
+        upscaler_blend(&scalar, screen);
+    }
+    ASSERT_EQ(memcmp(simd.intensity, scalar.intensity, SCREEN_SIZE), 0);
+
+    std::vector<uint32_t> a(w * h), b(w * h);
+    upscaler_render(&simd, a.data(), w * 4);
+    upscaler_render(&scalar, b.data(), w * 4);
+    ASSERT_EQ(a, b);
+
+    upscaler_destroy(&simd);
+    upscaler_destroy(&scalar);
+}
+
+TEST(Upscaler, Decay) {
+    Upscaler up;
+    ASSERT_EQ(upscaler_create(&up, SCREEN_WIDTH, SCREEN_HEIGHT, FILTER_NEAREST, 0x80), 0);
+    uint8_t screen[SCREEN_SIZE] = {};
+
+    screen[5] = 1;
+    upscaler_blend(&up, screen);
+    ASSERT_EQ(up.intensity[5], 0xFF);
+
+    // sprite XOR-erased for a frame keeps glowing
+    screen[5] = 0;
+    upscaler_blend(&up, screen);
+    ASSERT_EQ(up.intensity[5], 0x7F);
+
+    uint32_t pixels[SCREEN_SIZE];
+    upscaler_render(&up, pixels, SCREEN_WIDTH * 4);
+    ASSERT_EQ(pixels[5], 0xFF7F7F7F);
+    ASSERT_EQ(pixels[0], 0xFF000000);
+    upscaler_destroy(&up);
+}
+
+TEST(Upscaler, Scale2xCorner) {
+    Upscaler up;
+    ASSERT_EQ(upscaler_create(&up, SCREEN_WIDTH * 2, SCREEN_HEIGHT * 2, FILTER_SCALE2X, 0), 0);
+    uint8_t screen[SCREEN_SIZE] = {};
+
+    // diagonal step: (1,0) and (0,1) lit, (1,1) dark gets its corner rounded
+    screen[1] = 1;
+    screen[SCREEN_WIDTH] = 1;
+    upscaler_blend(&up, screen);
+
+    std::vector<uint32_t> pixels(SCREEN_SIZE * 4);
+    upscaler_render(&up, pixels.data(), SCREEN_WIDTH * 2 * 4);
+    int w = SCREEN_WIDTH * 2;
+    ASSERT_EQ(pixels[2 * w + 2], 0xFFFFFFFF); // top-left quarter of (1,1)
+    ASSERT_EQ(pixels[3 * w + 3], 0xFF000000);
+    upscaler_destroy(&up);
+}
+
+TEST(Upscaler, SimdMatchesScalar) {
+    for (SimdLevel level : {SIMD_SSE2, SIMD_AVX2}) {
+        compare_paths(level, FILTER_NEAREST, 1920, 1080);
+        compare_paths(level, FILTER_SCALE2X, 1920, 1080);
+        compare_paths(level, FILTER_SCALE3X, 1920, 1080);
+        compare_paths(level, FILTER_SCALE3X, 641, 321);
+    }
+}